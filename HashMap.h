@@ -0,0 +1,355 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the 
+ * Free Software Foundation, either version 3 of the License, or (at your 
+ * option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY 
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+  A typed hash map using the open addressing, Robin Hood probing scheme of
+  create_hashtable_open() in hashtable.c, with keys and values stored inline
+  in the slot array rather than behind void pointers. Hashing and comparison
+  are chosen at compile time by HashMapKey<K>, which is provided for
+  integers and enums, std::array of integers, std::string and C strings.
+
+  Unlike std::map, entries are not kept in key order, and adding an entry may
+  move the others, so references into the map are only good until the next
+  insert.
+
+  Author: Andrew Somerville <andy16666@gmail.com>
+  GitHub: andy16666
+ */
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+extern "C" {
+#include <hashtable.h>
+}; 
+
+namespace AOS
+{
+  template <typename K, typename Enable = void>
+  struct HashMapKey; 
+
+  // Integers and enums use the MurmurHash3 finaliser, which mixes every bit 
+  // of the value into the low bits that index the table. 
+  template <typename K>
+  struct HashMapKey<K, typename std::enable_if<std::is_integral<K>::value || std::is_enum<K>::value>::type>
+  {
+    static uint32_t hash(const K& key)
+    {
+      uint64_t v = static_cast<uint64_t>(key); 
+      uint32_t h = (uint32_t)v ^ (uint32_t)(v >> 32); 
+
+      h ^= h >> 16; 
+      h *= 0x85ebca6b; 
+      h ^= h >> 13; 
+      h *= 0xc2b2ae35; 
+      h ^= h >> 16; 
+
+      return h; 
+    }; 
+
+    static bool equal(const K& a, const K& b) { return a == b; }; 
+  }; 
+
+  // Fixed arrays of integers, such as one wire addresses. 
+  template <typename T, size_t N>
+  struct HashMapKey<std::array<T, N>>
+  {
+    static_assert(std::is_integral<T>::value, "HashMapKey arrays must be of an integer type"); 
+
+    static uint32_t hash(const std::array<T, N>& key) { return hashtable_hash_murmur3(key.data(), sizeof(T) * N); }; 
+    static bool equal(const std::array<T, N>& a, const std::array<T, N>& b) { return !memcmp(a.data(), b.data(), sizeof(T) * N); }; 
+  }; 
+
+  template <>
+  struct HashMapKey<std::string>
+  {
+    static uint32_t hash(const std::string& key) { return hashtable_hash_murmur3(key.data(), key.size()); }; 
+    static bool equal(const std::string& a, const std::string& b) { return a == b; }; 
+  }; 
+
+  // The strings are not copied, so they must outlive their entries. 
+  template <>
+  struct HashMapKey<const char*>
+  {
+    static uint32_t hash(const char* key) { return hashtable_hash_murmur3(key, strlen(key)); }; 
+    static bool equal(const char* a, const char* b) { return !strcmp(a, b); }; 
+  }; 
+
+  template <typename K, typename V, typename Key = HashMapKey<K>>
+  class HashMap
+  {
+    public: 
+      // Public members so that entries can be unpacked with for (auto &[k, v] : map). 
+      struct Entry
+      {
+        K key; 
+        V value; 
+      }; 
+
+    private: 
+      struct Slot
+      {
+        // 0 if the slot is empty, otherwise one more than its entry's distance from its home slot. 
+        uint32_t distance; 
+        uint32_t hash; 
+        alignas(Entry) unsigned char storage[sizeof(Entry)]; 
+
+        Entry& entry() { return *reinterpret_cast<Entry*>(storage); }; 
+      }; 
+
+      Slot* slots; 
+      size_t slotCount; 
+      size_t entryCount; 
+
+      static size_t powerOfTwo(size_t n)
+      {
+        size_t size = 8; 
+        while (size < n)
+          size <<= 1; 
+        return size; 
+      }; 
+
+      // The index of the key's slot, or slotCount if it is absent. 
+      size_t locate(const K& key, uint32_t hash) const
+      {
+        size_t mask = slotCount - 1; 
+        size_t i = hash & mask; 
+
+        for (uint32_t distance = 1; ; distance++, i = (i + 1) & mask)
+        {
+          Slot& slot = slots[i]; 
+
+          // Robin Hood order means the key would have displaced this entry. 
+          if (slot.distance < distance)
+            return slotCount; 
+
+          if (slot.hash == hash && Key::equal(slot.entry().key, key))
+            return i; 
+        }
+      }; 
+
+      // Places an entry whose key is absent and returns it. 
+      Entry* place(uint32_t hash, Entry&& entry)
+      {
+        if ((entryCount + 1) * 8 > slotCount * 7)
+          resize(slotCount * 2); 
+
+        size_t mask = slotCount - 1; 
+        size_t i = hash & mask; 
+        uint32_t distance = 1; 
+        Entry carried(std::move(entry)); 
+        Entry* placed = 0; 
+
+        for (;; distance++, i = (i + 1) & mask)
+        {
+          Slot& slot = slots[i]; 
+
+          if (!slot.distance)
+          {
+            new (slot.storage) Entry(std::move(carried)); 
+            slot.distance = distance; 
+            slot.hash = hash; 
+            entryCount++; 
+            return placed ? placed : &slot.entry(); 
+          }
+
+          if (slot.distance < distance)
+          {
+            std::swap(carried, slot.entry()); 
+            std::swap(distance, slot.distance); 
+            std::swap(hash, slot.hash); 
+            if (!placed)
+              placed = &slot.entry(); 
+          }
+        }
+      }; 
+
+      void resize(size_t size)
+      {
+        Slot* old = slots; 
+        size_t oldCount = slotCount; 
+
+        slots = (Slot*)calloc(size, sizeof(Slot)); 
+        slotCount = size; 
+        entryCount = 0; 
+
+        for (size_t i = 0; i < oldCount; i++)
+        {
+          if (old[i].distance)
+          {
+            place(old[i].hash, std::move(old[i].entry())); 
+            old[i].entry().~Entry(); 
+          }
+        }
+
+        free(old); 
+      }; 
+
+    public: 
+      class Iterator
+      {
+        private: 
+          Slot* slot; 
+          Slot* end; 
+
+          void skip()
+          {
+            while (slot != end && !slot->distance)
+              slot++; 
+          }; 
+
+        public: 
+          Iterator(Slot* slot, Slot* end) : slot(slot), end(end) { skip(); }; 
+
+          Entry& operator*() { return slot->entry(); }; 
+          Entry* operator->() { return &slot->entry(); }; 
+          Iterator& operator++() { slot++; skip(); return *this; }; 
+          bool operator!=(const Iterator& other) const { return slot != other.slot; }; 
+          bool operator==(const Iterator& other) const { return slot == other.slot; }; 
+      }; 
+
+      /**
+       * The slot array is rounded up to a power of two and doubles when it is
+       * 7/8 full.
+       */
+      HashMap(size_t capacity = 8) : slotCount(powerOfTwo(capacity)), entryCount(0)
+      {
+        slots = (Slot*)calloc(slotCount, sizeof(Slot)); 
+      }; 
+
+      HashMap(const HashMap& other) : HashMap(other.slotCount)
+      {
+        for (size_t i = 0; i < other.slotCount; i++)
+          if (other.slots[i].distance)
+            place(other.slots[i].hash, Entry(other.slots[i].entry())); 
+      }; 
+
+      HashMap(HashMap&& other) : slots(other.slots), slotCount(other.slotCount), entryCount(other.entryCount)
+      {
+        other.slots = (Slot*)calloc(8, sizeof(Slot)); 
+        other.slotCount = 8; 
+        other.entryCount = 0; 
+      }; 
+
+      HashMap& operator=(HashMap other)
+      {
+        std::swap(slots, other.slots); 
+        std::swap(slotCount, other.slotCount); 
+        std::swap(entryCount, other.entryCount); 
+        return *this; 
+      }; 
+
+      ~HashMap()
+      {
+        clear(); 
+        free(slots); 
+      }; 
+
+      /**
+       * Adds the entry unless the key is present. Returns false if it was.
+       */
+      bool insert(const K& key, const V& value)
+      {
+        uint32_t hash = Key::hash(key); 
+        if (locate(key, hash) != slotCount)
+          return false; 
+
+        place(hash, Entry{key, value}); 
+        return true; 
+      }; 
+
+      /**
+       * The value for the key, which is default constructed and added if the
+       * key is absent.
+       */
+      V& operator[](const K& key)
+      {
+        uint32_t hash = Key::hash(key); 
+        size_t i = locate(key, hash); 
+        if (i != slotCount)
+          return slots[i].entry().value; 
+
+        return place(hash, Entry{key, V()})->value; 
+      }; 
+
+      /**
+       * The value for the key, or null if it is absent.
+       */
+      V* find(const K& key)
+      {
+        size_t i = locate(key, Key::hash(key)); 
+        return i != slotCount ? &slots[i].entry().value : 0; 
+      }; 
+
+      size_t count(const K& key) const { return locate(key, Key::hash(key)) != slotCount; }; 
+
+      /**
+       * Removes the entry for the key, shifting back those probed past it.
+       * Returns false if the key was absent.
+       */
+      bool erase(const K& key)
+      {
+        size_t mask = slotCount - 1; 
+        size_t i = locate(key, Key::hash(key)); 
+        if (i == slotCount)
+          return false; 
+
+        slots[i].entry().~Entry(); 
+
+        size_t next = (i + 1) & mask; 
+        while (slots[next].distance > 1)
+        {
+          new (slots[i].storage) Entry(std::move(slots[next].entry())); 
+          slots[next].entry().~Entry(); 
+          slots[i].distance = slots[next].distance - 1; 
+          slots[i].hash = slots[next].hash; 
+
+          i = next; 
+          next = (i + 1) & mask; 
+        }
+
+        slots[i].distance = 0; 
+        entryCount--; 
+        return true; 
+      }; 
+
+      void clear()
+      {
+        for (size_t i = 0; i < slotCount; i++)
+        {
+          if (slots[i].distance)
+          {
+            slots[i].entry().~Entry(); 
+            slots[i].distance = 0; 
+          }
+        }
+        entryCount = 0; 
+      }; 
+
+      size_t size() const { return entryCount; }; 
+      bool isEmpty() const { return !entryCount; }; 
+      size_t capacity() const { return slotCount; }; 
+
+      Iterator begin() { return Iterator(slots, slots + slotCount); }; 
+      Iterator end() { return Iterator(slots + slotCount, slots + slotCount); }; 
+  }; 
+}
@@ -0,0 +1,113 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the 
+ * Free Software Foundation, either version 3 of the License, or (at your 
+ * option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY 
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+  A fixed capacity, lock-free, single producer/single consumer queue for 
+  passing values between the two cores without disabling interrupts or 
+  spinning. Exactly one context may push and exactly one context may pop. 
+
+  If a consumer process is set, the producer signals it after each push so 
+  that its kernel runs it on its next pass. 
+
+  Author: Andrew Somerville <andy16666@gmail.com> 
+  GitHub: andy16666
+ */
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+extern "C" {
+#include <threadkernel.h>
+};
+
+namespace AOS
+{
+  template <typename T, size_t N>
+  class SPSCQueue
+  {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SPSCQueue capacity must be a power of two"); 
+
+    private: 
+      T buffer[N]; 
+
+      // Free running indices: head is only written by the consumer, tail only by the producer. 
+      std::atomic<size_t> head; 
+      std::atomic<size_t> tail; 
+
+      threadkernel_t* consumerKernel; 
+      process_t* consumerProcess; 
+
+    public: 
+      SPSCQueue() : head(0), tail(0) 
+      {
+        consumerKernel = 0; 
+        consumerProcess = 0; 
+      }; 
+
+      /**
+       * Signal the given process whenever a value is pushed. 
+       */
+      void setConsumer(threadkernel_t* k, process_t* process)
+      {
+        consumerKernel = k; 
+        consumerProcess = process; 
+      }; 
+
+      /**
+       * Producer only. Returns false if the queue is full. 
+       */
+      bool push(const T& value)
+      {
+        size_t t = tail.load(std::memory_order_relaxed); 
+        if (t - head.load(std::memory_order_acquire) >= N)
+          return false; 
+
+        buffer[t & (N - 1)] = value; 
+        tail.store(t + 1, std::memory_order_release); 
+
+        if (consumerProcess)
+          consumerKernel->signal(consumerKernel, consumerProcess); 
+
+        return true; 
+      }; 
+
+      /**
+       * Consumer only. Returns false if the queue is empty. 
+       */
+      bool pop(T& value)
+      {
+        size_t h = head.load(std::memory_order_relaxed); 
+        if (h == tail.load(std::memory_order_acquire))
+          return false; 
+
+        value = buffer[h & (N - 1)]; 
+        head.store(h + 1, std::memory_order_release); 
+
+        return true; 
+      }; 
+
+      bool isEmpty() 
+      { 
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); 
+      }; 
+
+      size_t size() 
+      { 
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire); 
+      }; 
+
+      size_t capacity() { return N; }; 
+  }; 
+}
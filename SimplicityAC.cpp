@@ -13,34 +13,27 @@
  * with this program. If not, see <https://www.gnu.org/licenses/>.
  */
 #include "SimplicityAC.h"
+#include "SPSCQueue.h"
 #include "aos.h"
 
 using namespace AOS; 
 using AOS::SimplicityAC; 
 using AOS::SimplicityACResponse; 
 
-volatile SimplicityACResponse* responseRef = 0; 
+// Responses fetched by execute() on core 0, waiting to be parsed on core 1. 
+static SPSCQueue<SimplicityACResponse*, 1> responses; 
 
 /**
- * Core 1: Parse the response from the air conditioner pointed to by responseRef; 
+ * Core 1: Parse the next response from the air conditioner, if there is one. 
  */  
 void SimplicityAC::parse()
 {   
-  if (!responseRef)
+  SimplicityACResponse *response; 
+  if (!responses.pop(response))
   {
     return; 
   }
 
-  //if(!TRYLOCK(acDataMutex))
-  //{
-    //return;
-  //}
-
-  SimplicityACResponse *response = (SimplicityACResponse*)responseRef; 
-  responseRef = nullptr; 
-  //UNLOCK( acDataMutex );
-  delay(1); 
-
   if(response->isOK() && response->hasPayload())
   {
     response->parse(this);  
@@ -51,7 +44,8 @@ void SimplicityAC::parse()
 
 bool SimplicityAC::execute(String params)
 {
-  if (responseRef)
+  // The previous response has not been parsed yet. 
+  if (responses.size() >= responses.capacity())
   {
     return false; 
   }
@@ -74,7 +68,7 @@ bool SimplicityAC::execute(String params)
     delay(1); 
     int code = httpClient.GET(); 
     delay(1); 
-    SimplicityACResponse *response = new SimplicityACResponse(url, code, millis()); 
+    SimplicityACResponse *response = new SimplicityACResponse(url, code, millis64()); 
     
     if (response->isOK())
     {
@@ -89,11 +83,8 @@ bool SimplicityAC::execute(String params)
     httpClient.end();
     delay(1); 
 
-    //LOCK( acDataMutex ); 
-    responseRef = (volatile SimplicityACResponse*)response; 
+    responses.push(response); 
     response = 0; 
-    //UNLOCK( acDataMutex );
-    delay(1); 
   }
   else 
   {
@@ -36,6 +36,10 @@
 
 #include "TemperatureSensors.h"
 
+extern "C" {
+#include <timebase.h>
+};
+
 #define AC_DATA_EXPIRY_TIME_MS 30 * 1000
 #define AC_OUTLET_IDLE_MIN_TEMP_C 15
 #define AC_EVAP_IDLE_MIN_TEMP_C 15
@@ -91,7 +95,7 @@ namespace AOS
       ac_state_t state; 
       fan_state_t fanState;
       compressor_state_t compressorState;  
-      unsigned long updateTimeMs; 
+      uint64_t updateTimeMs; 
       String hostname;
       bool set;
       
@@ -132,7 +136,7 @@ namespace AOS
       void setSet(bool set) { this->set = set; }; 
 
       bool isSet() { return set; };
-      bool isExpired() { return !isSet() || updateTimeMs < millis() - AC_DATA_EXPIRY_TIME_MS; };
+      bool isExpired() { return !isSet() || millis64() - updateTimeMs > AC_DATA_EXPIRY_TIME_MS; };
 
       bool isOutletCold()
       {
@@ -183,7 +187,7 @@ namespace AOS
       {
         document[key]["evapTempC"] = evapTempC; 
         document[key]["outletTempC"] = outletTempC; 
-        document[key]["lastUpdated"] = msToHumanReadableTime(millis() - updateTimeMs).c_str(); 
+        document[key]["lastUpdated"] = msToHumanReadableTime(millis64() - updateTimeMs).c_str(); 
         document[key]["command"] = String((char)command).c_str(); 
         document[key]["state"] = String((char)state).c_str(); 
         document[key]["fanState"] = String((char)fanState).c_str(); 
@@ -197,10 +201,10 @@ namespace AOS
       int code; 
       String payload; 
       String url; 
-      unsigned long time; 
+      uint64_t time; 
 
     public: 
-      SimplicityACResponse(String url, int code, unsigned long time) 
+      SimplicityACResponse(String url, int code, uint64_t time) 
       {
         this->code = code; 
         payload = String(""); 
@@ -208,7 +212,7 @@ namespace AOS
         this->time = time; 
       }; 
 
-      unsigned long getTime() { return time; }; 
+      uint64_t getTime() { return time; }; 
 
       bool hasPayload()
       {
@@ -223,7 +227,7 @@ namespace AOS
 
       void parse(SimplicityAC* ac); 
       String getPayload() { return payload; }; 
-      void setTime(unsigned long time) { this->time = time; }; 
+      void setTime(uint64_t time) { this->time = time; }; 
       void setCode(int code) { this->code = code; }
       int getCode() { return code; }; 
       bool isOK() { return code == HTTP_CODE_OK; }
@@ -232,11 +236,11 @@ namespace AOS
       {
         if (hasPayload())
         {
-          Serial.printf("\r[%d]%s: %d: %s\r\n", time, url.c_str(), getCode(), getPayload().c_str());
+          Serial.printf("\r[%lu]%s: %d: %s\r\n", (unsigned long)time, url.c_str(), getCode(), getPayload().c_str());
         }
         else 
         {
-          Serial.printf("\r[%d]%s: %d\r\n", time, url.c_str(), getCode());
+          Serial.printf("\r[%lu]%s: %d\r\n", (unsigned long)time, url.c_str(), getCode());
         }
       }
   }; 
@@ -37,7 +37,7 @@ bool TemperatureSensor::readTemp(DS18B20& ds)
   previousTempC = tempC; 
   tempC = ds.getTempC(); 
   previousReadMs = lastReadMs; 
-  lastReadMs = millis(); 
+  lastReadMs = millis64(); 
   read = true; 
   return true;
 }
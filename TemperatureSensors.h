@@ -39,6 +39,10 @@
 #include <DS18B20.h>
 #include <ArduinoJson.h>
 
+extern "C" {
+#include <timebase.h>
+};
+
 using namespace std;
 
 namespace AOS
@@ -62,8 +66,8 @@ namespace AOS
       float tempC;
       float previousTempC; 
       bool read;
-      unsigned long lastReadMs;
-      unsigned long previousReadMs; 
+      uint64_t lastReadMs;
+      uint64_t previousReadMs; 
       unsigned int tempErrors; 
 
     public:
@@ -115,17 +119,17 @@ namespace AOS
       
       bool isTempExpired() 
       {
-        return !read || lastReadMs < (millis() - TEMP_EXPIRY_TIME_MS);  
+        return !read || millis64() - lastReadMs > TEMP_EXPIRY_TIME_MS;  
       };
 
       double getAgeSeconds()
       {
-        return (millis() - lastReadMs) / 1E3;
+        return (millis64() - lastReadMs) / 1E3;
       }
 
       double getRateOfChangeDegreesPerSecond()
       {
-        // Rollover or init
+        // Not yet read twice
         if (lastReadMs <= previousReadMs) 
           return 0; 
 
@@ -29,28 +29,28 @@ Thermostat::Thermostat(std::string name)
   heatOn = false; 
   setPointC = 20.0; 
   currentTemperatureC = 20.0; 
-  lastUpdatedCommandMs = millis(); 
-  lastUpdatedCurrentTempMs = millis(); 
-  lastUpdatedSetpointMs = millis(); 
-  lastUpdatedHeatOnMs = millis(); 
+  lastUpdatedCommandMs = millis64(); 
+  lastUpdatedCurrentTempMs = millis64(); 
+  lastUpdatedSetpointMs = millis64(); 
+  lastUpdatedHeatOnMs = millis64(); 
 } 
 
-unsigned long Thermostat::getLastUpdatedCurrentTempMs() const
+uint64_t Thermostat::getLastUpdatedCurrentTempMs() const
 {
   return this->lastUpdatedCurrentTempMs; 
 }
 
-unsigned long Thermostat::getLastUpdatedSetpointMs() const
+uint64_t Thermostat::getLastUpdatedSetpointMs() const
 {
   return this->lastUpdatedSetpointMs;  
 }
 
-unsigned long Thermostat::getLastUpdatedCommandMs() const
+uint64_t Thermostat::getLastUpdatedCommandMs() const
 {
   return this->lastUpdatedCommandMs; 
 }
 
-unsigned long Thermostat::getLastUpdatedHeatOnMs() const
+uint64_t Thermostat::getLastUpdatedHeatOnMs() const
 {
   return this->lastUpdatedHeatOnMs; 
 }
@@ -58,25 +58,25 @@ unsigned long Thermostat::getLastUpdatedHeatOnMs() const
 void Thermostat::setSetPointC(float setPointC) 
 {
   this->setPointC = setPointC;
-  this->lastUpdatedSetpointMs = millis(); 
+  this->lastUpdatedSetpointMs = millis64(); 
 }
 
 void Thermostat::setCurrentTemperatureC(float currentTemperatureC) 
 {
   this->currentTemperatureC = currentTemperatureC;
-  this->lastUpdatedCurrentTempMs = millis(); 
+  this->lastUpdatedCurrentTempMs = millis64(); 
 }
 
 void Thermostat::setCommand(bool command) 
 {
   this->command = command;
-  this->lastUpdatedCommandMs = millis(); 
+  this->lastUpdatedCommandMs = millis64(); 
 }
 
 void Thermostat::setHeatOn(bool heatOn) 
 {
   this->heatOn = heatOn;
-  this->lastUpdatedHeatOnMs = millis(); 
+  this->lastUpdatedHeatOnMs = millis64(); 
 }
 
 float Thermostat::getSetPointC() const
@@ -124,10 +124,10 @@ float Thermostat::getMagnitude()
 
 bool Thermostat::isCurrent() 
 {
-  unsigned long timeMs = millis(); 
-  unsigned long commandAge = timeMs - getLastUpdatedCommandMs(); 
-  unsigned long setpointAge = timeMs - getLastUpdatedSetpointMs(); 
-  unsigned long currentTempAge = timeMs - getLastUpdatedCurrentTempMs(); 
+  uint64_t timeMs = millis64(); 
+  uint64_t commandAge = timeMs - getLastUpdatedCommandMs(); 
+  uint64_t setpointAge = timeMs - getLastUpdatedSetpointMs(); 
+  uint64_t currentTempAge = timeMs - getLastUpdatedCurrentTempMs(); 
 
   return commandAge < COMMAND_EXPIRY_TIME_MS && setpointAge < COMMAND_EXPIRY_TIME_MS && currentTempAge < COMMAND_EXPIRY_TIME_MS; 
 }
@@ -35,6 +35,10 @@
 
 #include "util.h"
 
+extern "C" {
+#include <timebase.h>
+};
+
 #define COMMAND_EXPIRY_TIME_MS 600000
 
 using namespace std;
@@ -52,10 +56,10 @@ namespace AOS
       float currentTemperatureC; 
       bool command; 
       bool heatOn; 
-      unsigned long lastUpdatedSetpointMs; 
-      unsigned long lastUpdatedCurrentTempMs; 
-      unsigned long lastUpdatedCommandMs; 
-      unsigned long lastUpdatedHeatOnMs; 
+      uint64_t lastUpdatedSetpointMs; 
+      uint64_t lastUpdatedCurrentTempMs; 
+      uint64_t lastUpdatedCommandMs; 
+      uint64_t lastUpdatedHeatOnMs; 
 
     public: 
       Thermostat() {}; 
@@ -79,19 +83,19 @@ namespace AOS
       void addTo(const char* key, JsonDocument& document) 
       {
         document[key][name.c_str()]["setPointC"] = setPointC; 
-        document[key][name.c_str()]["setPointAge"] = msToHumanReadableTime(millis() - lastUpdatedSetpointMs); 
+        document[key][name.c_str()]["setPointAge"] = msToHumanReadableTime(millis64() - lastUpdatedSetpointMs); 
         document[key][name.c_str()]["currentTempC"] = currentTemperatureC; 
-        document[key][name.c_str()]["currentAge"] = msToHumanReadableTime(millis() - lastUpdatedCurrentTempMs); 
+        document[key][name.c_str()]["currentAge"] = msToHumanReadableTime(millis64() - lastUpdatedCurrentTempMs); 
         document[key][name.c_str()]["command"] = command; 
-        document[key][name.c_str()]["commandAge"] = msToHumanReadableTime(millis() - lastUpdatedCommandMs); 
+        document[key][name.c_str()]["commandAge"] = msToHumanReadableTime(millis64() - lastUpdatedCommandMs); 
         document[key][name.c_str()]["heatOn"] = heatOn; 
-        document[key][name.c_str()]["heatOnAge"] = msToHumanReadableTime(millis() - lastUpdatedHeatOnMs); 
+        document[key][name.c_str()]["heatOnAge"] = msToHumanReadableTime(millis64() - lastUpdatedHeatOnMs); 
       }
 
-      unsigned long getLastUpdatedSetpointMs() const; 
-      unsigned long getLastUpdatedCurrentTempMs() const; 
-      unsigned long getLastUpdatedCommandMs() const; 
-      unsigned long getLastUpdatedHeatOnMs() const; 
+      uint64_t getLastUpdatedSetpointMs() const; 
+      uint64_t getLastUpdatedCurrentTempMs() const; 
+      uint64_t getLastUpdatedCommandMs() const; 
+      uint64_t getLastUpdatedHeatOnMs() const; 
       
   };
 
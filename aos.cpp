@@ -22,7 +22,10 @@
 #include "aos.h"
 #include "config.h"
 #include "util.h"
+#include "SPSCQueue.h"
 #include <LittleFS.h> 
+#include <pico/time.h>
+#include <hardware/sync.h>
 
 #if defined(PICO_CYW43_SUPPORTED)
 #include <WebServer.h>
@@ -58,7 +61,6 @@ volatile double                   timeBaseSeconds          __attribute__((sectio
 
 // Total time since power up. 
 volatile unsigned long            powerUpTime              __attribute__((section(".uninitialized_data")));
-volatile unsigned long            numRebootsMillisRollover __attribute__((section(".uninitialized_data")));
 volatile unsigned long            numRebootsDisconnected   __attribute__((section(".uninitialized_data")));
 volatile unsigned long            numRebootsPingFailed     __attribute__((section(".uninitialized_data")));
 volatile unsigned long            numRebootsWDT            __attribute__((section(".uninitialized_data")));
@@ -69,14 +71,23 @@ volatile unsigned long            lastProcess1             __attribute__((sectio
 volatile unsigned long            core0AliveAt __attribute__((section(".uninitialized_data"))); 
 volatile unsigned long            core1AliveAt __attribute__((section(".uninitialized_data")));
 
-threadkernel_t* CORE_0_KERNEL = create_threadkernel(&millis, &onMillisRollover, &micros, &beforeProcess0, &afterProcess0); 
-threadkernel_t* CORE_1_KERNEL = create_threadkernel(&millis, &onMillisRollover, &micros, &beforeProcess1, &afterProcess1); 
+// The last processes run on each core, served at /trace. 
+threadkernel_trace_t              core0Trace   __attribute__((section(".uninitialized_data"))); 
+threadkernel_trace_t              core1Trace   __attribute__((section(".uninitialized_data"))); 
+
+threadkernel_t* CORE_0_KERNEL = create_threadkernel(&millis64, &micros64, &beforeProcess0, &afterProcess0); 
+// Core 1 runs the control loops, which must not wait behind task_updateHttpResponse. 
+threadkernel_t* CORE_1_KERNEL = create_threadkernel_with_scheduler(&millis64, &micros64, &beforeProcess1, &afterProcess1, THREADKERNEL_SCHEDULER_EDF); 
 
 static const char* hostname = generateHostname();
 
+// The response currently served by core 0. Only core 0 touches it. 
 volatile char* httpResponseString;
-volatile bool  httpResponseStringModificationInProgress; 
-volatile bool  httpResponseStringReadInProgress; 
+
+// Responses serialized by core 1, waiting to be picked up by core 0. 
+static SPSCQueue<char*, 2> httpResponseReady; 
+// Buffers released by core 0, waiting to be refilled by core 1. 
+static SPSCQueue<char*, 2> httpResponseFree; 
 
 volatile int core2Start = 0; 
 
@@ -86,6 +97,23 @@ char indexHTML[HTML_BUFFER_SIZE];
 
 volatile unsigned int lastRebootCausedBy = 0;
 
+// Guards the state shared by both kernels: the process pool and the migratable 
+// processes, and core0Load. Holds the interrupt state saved by each core. 
+static spin_lock_t* kernelSpinLock; 
+static uint32_t kernelSavedIrq[2]; 
+
+// Load averages of a kernel and of its processes which have used any time. 
+struct LoadSnapshot
+{
+  uint32_t     kernel[THREADKERNEL_LOAD_AVERAGES]; 
+  unsigned int count; 
+  unsigned int pids[THREADKERNEL_MAX_PROCESSES]; 
+  uint32_t     load[THREADKERNEL_MAX_PROCESSES][THREADKERNEL_LOAD_AVERAGES]; 
+}; 
+
+// Published by core 0 for core 1, which cannot walk core 0's processes. 
+static LoadSnapshot core0Load; 
+
 void setup() 
 {
   if (initialize)
@@ -96,10 +124,11 @@ void setup()
     powerUpTime = millis(); 
     numRebootsPingFailed = 0;  
     numRebootsDisconnected = 0; 
-    numRebootsMillisRollover = 0; 
     numRebootsWDT = 0; 
     lastProcess0 = 0; 
     lastProcess1 = 0; 
+    threadkernel_reset_trace(&core0Trace); 
+    threadkernel_reset_trace(&core1Trace); 
     aosInitialize(); 
     initialize = 0; 
   }
@@ -122,6 +151,17 @@ void setup()
   core0AliveAt = millis(); 
   core1AliveAt = millis();
 
+  threadkernel_attach_trace(CORE_0_KERNEL, &core0Trace, 0); 
+  threadkernel_attach_trace(CORE_1_KERNEL, &core1Trace, 1); 
+
+  kernelSpinLock = spin_lock_instance(spin_lock_claim_unused(true)); 
+  threadkernel_set_lock(kernelLock, kernelUnlock); 
+
+  CORE_0_KERNEL->onIdle = kernelIdle; 
+  CORE_0_KERNEL->onSignal = kernelSignal; 
+  CORE_1_KERNEL->onIdle = kernelIdle; 
+  CORE_1_KERNEL->onSignal = kernelSignal; 
+
   cpu.begin(); 
 
   setenv("TZ", TIMEZONE, 1); 
@@ -133,6 +173,10 @@ void setup()
   httpResponseString = (volatile char*)malloc(HTTP_RESPONSE_BUFFER_SIZE * sizeof(char)); 
   httpResponseString[0] = 0;
 
+  char* httpResponseSpare = (char*)malloc(HTTP_RESPONSE_BUFFER_SIZE * sizeof(char)); 
+  httpResponseSpare[0] = 0; 
+  httpResponseFree.push(httpResponseSpare); 
+
 #if defined(PICO_CYW43_SUPPORTED)
   
   wifi_connect();
@@ -212,6 +256,8 @@ void setup()
     DPRINTLN("Leave / handler"); 
   });
 
+  server.on("/trace", handleHttpTrace); 
+
   NPRINTLN("Handler Initialized");
 #endif
 
@@ -219,6 +265,9 @@ void setup()
   PICOW CORE_0_KERNEL->addImmediate(CORE_0_KERNEL, task_testWiFiConnection); 
   PICOW CORE_0_KERNEL->addImmediate(CORE_0_KERNEL, task_handleHttpClient); 
   CORE_0_KERNEL->add(CORE_0_KERNEL, task_core0ActOn, 1000); 
+  CORE_0_KERNEL->add(CORE_0_KERNEL, task_publishCore0Load, THREADKERNEL_LOAD_SAMPLE_MICROS / 1000); 
+  process_t* httpResponseReceiver = CORE_0_KERNEL->addImmediate(CORE_0_KERNEL, task_receiveHttpResponse); 
+  httpResponseReady.setConsumer(CORE_0_KERNEL, httpResponseReceiver); 
   PICOW CORE_0_KERNEL->add(CORE_0_KERNEL, task_testPing, PING_INTERVAL_MS); 
   NPRINTLN("Calling aosSetup()"); 
   aosSetup(); 
@@ -239,20 +288,14 @@ void setup()
 
 String getHttpResponseString()
 {
-  httpResponseStringReadInProgress = true; 
-        while(httpResponseStringModificationInProgress); 
-
-  String responseString = String(httpResponseString[0] ? (char *)httpResponseString : "{ 'status':\"Loading...\" }");
-
-  httpResponseStringReadInProgress = false; 
-
-  return responseString; 
+  return String(httpResponseString[0] ? (char *)httpResponseString : "{ 'status':\"Loading...\" }");
 }
 
 void setup1()
 {
   while(!core2Start); 
-  CORE_1_KERNEL->addImmediate(CORE_1_KERNEL, task_updateHttpResponse);  
+  process_t* httpResponseUpdater = CORE_1_KERNEL->addImmediate(CORE_1_KERNEL, task_updateHttpResponse);  
+  httpResponseFree.setConsumer(CORE_1_KERNEL, httpResponseUpdater); 
   CORE_1_KERNEL->add(CORE_1_KERNEL, task_core1ActOn, 1000); 
   CORE_1_KERNEL->add(CORE_1_KERNEL, task_readTemperatures, TemperatureSensor::READ_INTERVAL_MS); 
   aosSetup1();  
@@ -279,18 +322,21 @@ bool watchdogCallback(repeating_timer*)
 
   //rp2040.wdt_reset(); 
 
-  if (!core2Start || timeMs < STARTUP_GRACE_PERIOD_MS)
+  if (!core2Start || millis64() < STARTUP_GRACE_PERIOD_MS)
   {
     return true; 
   }
 
-  if (core0AliveAt < timeMs - WATCHDOG_TIMER_REBOOT_MS) 
+  // The alive timestamps are 32 bits wide, so compare their age, which survives rollover. 
+  // The age is signed because a core may have stamped a newer millis() since 
+  // timeMs was read, which would otherwise wrap to a huge age. 
+  if ((long)(timeMs - core0AliveAt) > WATCHDOG_TIMER_REBOOT_MS) 
   {
     numRebootsWDT++; 
     reboot();   
   }
 
-  if (core2Start && core1AliveAt < timeMs - WATCHDOG_TIMER_REBOOT_MS) 
+  if (core2Start && (long)(timeMs - core1AliveAt) > WATCHDOG_TIMER_REBOOT_MS) 
   {
     numRebootsWDT++; 
     reboot(); 
@@ -340,14 +386,34 @@ void afterProcess1(process_t *p)
   delay(1); 
 }
 
-double seconds()
+/**
+ * Sleep the calling core until the next process is due, an interrupt arrives 
+ * or the other core signals one of our processes. 
+ */
+void kernelIdle(threadkernel_t *k, uint64_t milliseconds)
+{
+  best_effort_wfe_or_timeout(make_timeout_time_ms(milliseconds < KERNEL_IDLE_MAX_MS ? milliseconds : KERNEL_IDLE_MAX_MS)); 
+}
+
+void kernelSignal()
+{
+  __sev(); 
+}
+
+void kernelLock()
 {
-  return timeBaseSeconds + (millis()/1E3); 
+  uint32_t savedIrq = spin_lock_blocking(kernelSpinLock); 
+  kernelSavedIrq[get_core_num()] = savedIrq; 
 }
 
-void onMillisRollover()
+void kernelUnlock()
 {
-  reboot();
+  spin_unlock(kernelSpinLock, kernelSavedIrq[get_core_num()]); 
+}
+
+double seconds()
+{
+  return timeBaseSeconds + (millis64()/1E3); 
 }
 
 void setupFrontEnd(const char * htmlFilePath)
@@ -408,23 +474,109 @@ void task_handleHttpClient()
   delay(1); 
 }
 
+static inline void addLoad(JsonArray array, const uint32_t load[THREADKERNEL_LOAD_AVERAGES])
+{
+  for (unsigned int i = 0; i < THREADKERNEL_LOAD_AVERAGES; i++)
+  {
+    array.add(roundf(threadkernel_load_percent(load, i) * 10) / 10); 
+  }
+}
+
+/*
+  Copies the load averages of k and of its processes which have used any 
+  time. Only the core which runs k may walk its processes. 
+ */
+static inline void takeLoadSnapshot(threadkernel_t* k, LoadSnapshot& snapshot)
+{
+  memcpy(snapshot.kernel, k->load, sizeof(snapshot.kernel)); 
+  snapshot.count = 0; 
+
+  for (process_t* p = k->firstProcess(k); p && snapshot.count < THREADKERNEL_MAX_PROCESSES; p = k->nextProcess(k, p))
+  {
+    if (p->load[THREADKERNEL_LOAD_60S])
+    {
+      snapshot.pids[snapshot.count] = p->pid; 
+      memcpy(snapshot.load[snapshot.count], p->load, sizeof(p->load)); 
+      snapshot.count++; 
+    }
+  }
+}
+
+/**
+ * Core 0: Publish core 0's load averages for core 1 to serve. 
+ */
+void task_publishCore0Load()
+{
+  kernelLock(); 
+  takeLoadSnapshot(CORE_0_KERNEL, core0Load); 
+  kernelUnlock(); 
+}
+
+/**
+ * 1s, 10s and 60s load averages in percent for each core, and for each 
+ * process which has used any time, keyed by pid. 
+ */
+static inline void addLoadStats(const char *prefix, JsonDocument& document)
+{
+  // Static, as they are too big for core 1's stack; only core 1 uses them. 
+  static LoadSnapshot snapshots[2]; 
+
+  kernelLock(); 
+  snapshots[0] = core0Load; 
+  kernelUnlock(); 
+  takeLoadSnapshot(CORE_1_KERNEL, snapshots[1]); 
+
+  for (unsigned int core = 0; core < 2; core++)
+  {
+    const LoadSnapshot& snapshot = snapshots[core]; 
+    String coreName = "core" + String(core); 
+    addLoad(document[prefix][coreName].to<JsonArray>(), snapshot.kernel); 
+
+    for (unsigned int i = 0; i < snapshot.count; i++)
+      addLoad(document[prefix]["pids"][String(snapshot.pids[i])].to<JsonArray>(), snapshot.load[i]); 
+  }
+}
+
 static inline void addUptimeStats(const char *prefix, JsonDocument& document)
 {
   //document[prefix]["time"] = getFotmattedRealTime();
   document[prefix]["powered"] = secondsToHMS(seconds()).c_str();
-  document[prefix]["booted"] = msToHumanReadableTime(millis() - startupTime).c_str();
-  document[prefix]["connected"] = msToHumanReadableTime(millis() - connectTime).c_str();
+  document[prefix]["booted"] = msToHumanReadableTime(millis64() - startupTime).c_str();
+  document[prefix]["connected"] = msToHumanReadableTime(millis64() - connectTime).c_str();
   document[prefix]["numRebootsPingFailed"] = numRebootsPingFailed; 
   document[prefix]["numRebootsDisconnected"] = numRebootsDisconnected; 
-  document[prefix]["numRebootsMillisRollover"] = numRebootsMillisRollover; 
   document[prefix]["numRebootsWDT"] = numRebootsWDT; 
   document[prefix]["lastRebootCausedBy"] = lastRebootCausedBy; 
   document[prefix]["core0AliveAt"] = msToHumanReadableTime(millis() - core0AliveAt).c_str();
   document[prefix]["core1AliveAt"] = msToHumanReadableTime(millis() - core1AliveAt).c_str();
+  document[prefix]["core0IdlePct"] = 100.0 * CORE_0_KERNEL->idleMicros / (micros64() - CORE_0_KERNEL->createdMicros); 
+  document[prefix]["core1IdlePct"] = 100.0 * CORE_1_KERNEL->idleMicros / (micros64() - CORE_1_KERNEL->createdMicros); 
+  document[prefix]["core0DeadlineMisses"] = CORE_0_KERNEL->deadlineMisses; 
+  document[prefix]["core1DeadlineMisses"] = CORE_1_KERNEL->deadlineMisses; 
+  document[prefix]["core0BudgetOverruns"] = CORE_0_KERNEL->budgetOverruns; 
+  document[prefix]["core1BudgetOverruns"] = CORE_1_KERNEL->budgetOverruns; 
+  document[prefix]["core0LastBudgetOverrunPid"] = CORE_0_KERNEL->lastBudgetOverrunPid; 
+  document[prefix]["core1LastBudgetOverrunPid"] = CORE_1_KERNEL->lastBudgetOverrunPid; 
+  document[prefix]["core0MigratableRuns"] = CORE_0_KERNEL->migratableRuns; 
+  document[prefix]["core1MigratableRuns"] = CORE_1_KERNEL->migratableRuns; 
+  document[prefix]["core0DispatchOverheadNs"] = threadkernel_dispatch_overhead_nanos(CORE_0_KERNEL); 
+  document[prefix]["core1DispatchOverheadNs"] = threadkernel_dispatch_overhead_nanos(CORE_1_KERNEL); 
 }
 
+/**
+ * Core 1: Serialize the latest state into a buffer released by core 0. 
+ */
 void task_updateHttpResponse() 
 {
+  char* buffer; 
+  if (!httpResponseFree.pop(buffer))
+  {
+    // Sleep until core 0 hands a buffer back. 
+    CORE_1_KERNEL->nothingToDo(CORE_1_KERNEL); 
+    CORE_1_KERNEL->wait(CORE_1_KERNEL); 
+    return; 
+  }
+
   JsonDocument document; 
 
   TEMPERATURES.addTo(document); 
@@ -437,24 +589,43 @@ void task_updateHttpResponse()
   Ping::stats.addStats("ping", document); 
 #endif
   document["freeHeapB"] = getFreeHeap(); 
-  addUptimeStats("uptime", document); 
+  document["freeProcesses"] = threadkernel_processes_available(); 
+  document["processAllocationFailures"] = threadkernel_process_allocation_failures(); 
+  addUptimeStats("uptime", document);
+  addLoadStats("load", document); 
+
+  buffer[HTTP_RESPONSE_BUFFER_SIZE - 1] = 0; 
+  serializeJson(document, buffer, HTTP_RESPONSE_BUFFER_SIZE * sizeof(char)); 
+  if(buffer[HTTP_RESPONSE_BUFFER_SIZE - 1])
+  {
+    WPRINTLN("httpResponseString buffer full");
+    buffer[HTTP_RESPONSE_BUFFER_SIZE - 1] = 0; 
+  }
 
-  httpResponseStringModificationInProgress = true; 
-  if (httpResponseStringReadInProgress) 
+  httpResponseReady.push(buffer); 
+}
+
+/**
+ * Core 0: Swap in the newest response from core 1 and hand the old buffer back. 
+ */
+void task_receiveHttpResponse()
+{
+  char* buffer; 
+  bool received = false; 
+  while (httpResponseReady.pop(buffer))
   {
-      httpResponseStringModificationInProgress = false; 
-      return; 
+    httpResponseFree.push((char *)httpResponseString); 
+    httpResponseString = buffer; 
+    received = true; 
   }
 
-  httpResponseString[HTTP_RESPONSE_BUFFER_SIZE - 1] = 0; 
-  serializeJson(document, (char *)httpResponseString, HTTP_RESPONSE_BUFFER_SIZE * sizeof(char)); 
-  if(httpResponseString[HTTP_RESPONSE_BUFFER_SIZE - 1])
+  if (!received)
   {
-    WPRINTLN("httpResponseString buffer full");
-    httpResponseString[HTTP_RESPONSE_BUFFER_SIZE - 1] = 0; 
+    CORE_0_KERNEL->nothingToDo(CORE_0_KERNEL); 
   }
 
-  httpResponseStringModificationInProgress = false; 
+  // Sleep until core 1 posts the next response. 
+  CORE_0_KERNEL->wait(CORE_0_KERNEL); 
 }
 
 void task_core0ActOn()  { digitalWrite(CORE_0_ACT, 1); }
@@ -521,6 +692,60 @@ void handleHttpNotFound()
 #endif
 }
 
+/**
+ * Core 0: Stream both cores' trace rings as Chrome trace event JSON, which 
+ * loads in chrome://tracing and Perfetto. Each boot shows as a process and 
+ * each core as a thread, so the runs leading up to a watchdog reboot are 
+ * visible. A run which never finished is drawn as an instant event. 
+ */
+void handleHttpTrace()
+{
+#if defined(PICO_CYW43_SUPPORTED)
+  threadkernel_trace_t* traces[] = { &core0Trace, &core1Trace }; 
+  char buffer[1024]; 
+  size_t length = 0; 
+  bool first = true; 
+
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN); 
+  server.send(200, "application/json", "{\"traceEvents\":["); 
+
+  for (threadkernel_trace_t* trace : traces)
+  {
+    unsigned int count = threadkernel_trace_count(trace); 
+    for (unsigned int i = 0; i < count; i++)
+    {
+      threadkernel_trace_record_t record = *threadkernel_trace_record(trace, i); 
+
+      if (record.durationMicros == THREADKERNEL_TRACE_RUNNING)
+      {
+        length += snprintf(buffer + length, sizeof(buffer) - length, 
+          "%s{\"name\":\"pid %u\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%llu,\"pid\":%u,\"tid\":%u}", 
+          first ? "" : ",", record.pid, (unsigned long long)record.startMicros, record.boot, record.core); 
+      }
+      else 
+      {
+        length += snprintf(buffer + length, sizeof(buffer) - length, 
+          "%s{\"name\":\"pid %u\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%lu,\"pid\":%u,\"tid\":%u}", 
+          first ? "" : ",", record.pid, (unsigned long long)record.startMicros, 
+          (unsigned long)record.durationMicros, record.boot, record.core); 
+      }
+      first = false; 
+
+      // Each event is well under 128 characters. 
+      if (length > sizeof(buffer) - 128)
+      {
+        server.sendContent(buffer, length); 
+        length = 0; 
+      }
+    }
+  }
+
+  length += snprintf(buffer + length, sizeof(buffer) - length, "]}"); 
+  server.sendContent(buffer, length); 
+  server.sendContent(""); 
+#endif
+}
+
 bool is_wifi_connected() 
 {
 #if defined(PICO_CYW43_SUPPORTED)
@@ -565,7 +790,7 @@ void wifi_connect()
   DPRINT(hostname);
   DPRINTLN(".local");
 
-  connectTime = millis();
+  connectTime = millis64();
 #endif
 }
 
@@ -579,7 +804,7 @@ String getFotmattedRealTime()
 
 void reboot()
 {
-  timeBaseSeconds += millis() / 1E3; 
+  timeBaseSeconds += millis64() / 1E3; 
   rp2040.reboot(); 
 }
 
@@ -55,6 +55,7 @@
 #define STARTUP_GRACE_PERIOD_MS 200000
 #define WATCHDOG_TIMER_REBOOT_MS 60000
 #define WATCHDOG_TIMER_IRQ 1
+#define KERNEL_IDLE_MAX_MS 1000
 
 //#define DPRINT_ON
 #ifdef DPRINT_ON
@@ -92,14 +93,15 @@
 
 extern "C" {
 #include <threadkernel.h>
+#include <timebase.h>
 };
 
 extern AOS::TemperatureSensors TEMPERATURES; 
 extern CPU cpu; 
 extern volatile char* httpResponseString; 
 
-volatile inline unsigned long startupTime = millis();
-volatile inline unsigned long connectTime = millis();
+volatile inline uint64_t startupTime = millis64();
+volatile inline uint64_t connectTime = millis64();
 
 extern threadkernel_t* CORE_0_KERNEL; 
 extern threadkernel_t* CORE_1_KERNEL;
@@ -109,12 +111,15 @@ static void task_mdnsUpdate();
 static void wifi_connect();
 static bool is_wifi_connected();
 static void handleHttpNotFound(); 
+static void handleHttpTrace(); 
 
 static void task_testWiFiConnection(); 
 static void task_handleHttpClient(); 
 static void task_updateHttpResponse();
+static void task_receiveHttpResponse();
 
 static void task_readTemperatures();
+static void task_publishCore0Load(); 
 static void task_core0ActOn(); 
 static void task_core1ActOn(); 
 static void task_core0ActOff(); 
@@ -123,8 +128,11 @@ static void afterProcess0(process_t *process);
 static void beforeProcess0(process_t *process);
 static void afterProcess1(process_t *process);
 static void beforeProcess1(process_t *process);
+static void kernelIdle(threadkernel_t *k, uint64_t milliseconds);
+static void kernelSignal();
+static void kernelLock(); 
+static void kernelUnlock(); 
 static void readIndexHTML(const char * htmlFilePath);
-static void onMillisRollover();
 
 static void startWatchdogTimer(); 
 static bool watchdogCallback(repeating_timer*); 
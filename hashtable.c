@@ -17,11 +17,43 @@
 // Author: Andrew Somerville 
 #include "hashtable.h"
 
+// The stored key of a node or entry, which is inline when it is short enough. 
+#define ___HASHTABLE_KEY(n) ((n)->key_length <= HASHTABLE_INLINE_KEY_LENGTH ? (void *)(n)->inline_key : (n)->key)
+
+static unsigned int (*___hashtable_hash_function(hashtable_hash_t hash))(const void *, size_t) {
+	switch(hash) {
+		case HASHTABLE_HASH_FNV1A:      return hashtable_hash_fnv1a; 
+		case HASHTABLE_HASH_SHIFT_XOR:  return hashtable_hash_shift_xor; 
+		default:                        return hashtable_hash_murmur3; 
+	}
+}
+
+static int ___hashtable_power_of_two(int store_size) {
+	int size = 1; 
+	while (size < store_size) size <<= 1; 
+	return size; 
+}
+
 hashtable_t* create_hashtable(int store_size) {
+	return create_hashtable_with_hash(store_size, HASHTABLE_HASH_MURMUR3); 
+}
+
+hashtable_t* create_hashtable_with_hash(int store_size, hashtable_hash_t hash) {
 	hashtable_t *h = (hashtable_t *)malloc(sizeof(hashtable_t));
+
+	store_size = ___hashtable_power_of_two(store_size); 
 	
+	h->hash = ___hashtable_hash_function(hash); 
 	h->store_size = store_size; 
+	h->min_store_size = store_size; 
 	h->store = calloc(store_size, sizeof(hashtable_node_t*)); 
+	h->entries = NULL; 
+	h->old_store = NULL; 
+	h->old_entries = NULL; 
+	h->old_store_size = 0; 
+	h->rehash_index = 0; 
+	h->slabs = NULL; 
+	h->free_nodes = NULL; 
 	h->count = 0;
 
 	h->add      = ___hashtable_add; 
@@ -34,45 +66,131 @@ hashtable_t* create_hashtable(int store_size) {
 }
 
 void ___hashtable_destroy(hashtable_t *h) {
-	int i; 
-	for (i = 0; i < h->store_size; i++) {
-		hashtable_node_t* item; 
-		while((item = h->store[i])) {
-			h->store[i] = item->next; 
-			free(item); 
-			h->count--; 
-		}
-	} 
+	while(h->slabs) {
+		hashtable_slab_t *slab = h->slabs; 
+		h->slabs = slab->next; 
+		free(slab); 
+	}
+	free(h->store); 
+	free(h->old_store); 
 	free(h);
 }
 
-void  ___hashtable_add(hashtable_t *h, void *key, size_t key_length, void *item) {
-	hashtable_node_t *node = (hashtable_node_t *)malloc(sizeof(hashtable_node_t));
-		
-	node->key_length = key_length; 
-	node->key        = key; 
-	node->item       = item;
-	node->next       = NULL;
-	
-	int i = ___hashtable_hash(key, key_length, h->store_size); 
-	
-	hashtable_node_t **location = h->store + i; 
+static hashtable_node_t* ___hashtable_alloc_node(hashtable_t *h) {
+	if (!h->free_nodes) {
+		hashtable_slab_t *slab = (hashtable_slab_t *)malloc(sizeof(hashtable_slab_t)); 
+		int i; 
+
+		slab->next = h->slabs; 
+		h->slabs = slab; 
+		for (i = 0; i < HASHTABLE_SLAB_NODES; i++) {
+			slab->nodes[i].next = h->free_nodes; 
+			h->free_nodes = slab->nodes + i; 
+		}
+	}
+
+	hashtable_node_t *node = h->free_nodes; 
+	h->free_nodes = node->next; 
+	return node; 
+}
 
+static void ___hashtable_free_node(hashtable_t *h, hashtable_node_t *node) {
+	node->next = h->free_nodes; 
+	h->free_nodes = node; 
+}
+
+// Stores the key in a node or entry, copying it if it is short enough. 
+#define ___HASHTABLE_SET_KEY(n, k, length) do { \
+		(n)->key_length = (length); \
+		if ((length) <= HASHTABLE_INLINE_KEY_LENGTH) memcpy((n)->inline_key, (k), (length)); \
+		else (n)->key = (k); \
+	} while(0)
+
+static int ___hashtable_matches(hashtable_node_t *node, void *key, size_t key_length, unsigned int hash) {
+	return node->hash == hash && ___hashtable_compare_keys(key, key_length, ___HASHTABLE_KEY(node), node->key_length); 
+}
+
+static void ___hashtable_append(hashtable_node_t **location, hashtable_node_t *node) {
 	while(*location) {	
 		location = &((*location)->next);		
 	}
 	
+	node->next = NULL; 
 	*location = node; 	
+}
+
+static void ___hashtable_resize(hashtable_t *h) {
+	int store_size; 
+
+	if (h->old_store) return; 
+
+	if (h->count >= h->store_size * 2) store_size = h->store_size * 2; 
+	else if (h->count * 8 < h->store_size && h->store_size / 2 >= h->min_store_size) store_size = h->store_size / 2; 
+	else return; 
+
+	h->old_store = h->store; 
+	h->old_store_size = h->store_size; 
+	h->rehash_index = 0; 
+	h->store = calloc(store_size, sizeof(hashtable_node_t*)); 
+	h->store_size = store_size; 
+}
+
+// Moves the next few buckets of the old store, in order, so duplicate keys keep their order. 
+static void ___hashtable_rehash_step(hashtable_t *h) {
+	int step; 
+	for (step = 0; step < HASHTABLE_REHASH_STEP && h->rehash_index < h->old_store_size; step++) {
+		hashtable_node_t *node = h->old_store[h->rehash_index]; 
+		h->old_store[h->rehash_index++] = NULL; 
+
+		while(node) {
+			hashtable_node_t *next = node->next; 
+			___hashtable_append(h->store + (node->hash & (h->store_size - 1)), node); 
+			node = next; 
+		}
+	}
+
+	if (h->rehash_index == h->old_store_size) {
+		free(h->old_store); 
+		h->old_store = NULL; 
+		// The count may have crossed a threshold again while moving. 
+		___hashtable_resize(h); 
+	}
+}
+
+// The bucket which holds the hash: in the old store until its bucket there has been moved. 
+static hashtable_node_t** ___hashtable_bucket(hashtable_t *h, unsigned int hash) {
+	if (h->old_store) {
+		int i = hash & (h->old_store_size - 1); 
+		if (i >= h->rehash_index) return h->old_store + i; 
+	}
+
+	return h->store + (hash & (h->store_size - 1)); 
+}
+
+void  ___hashtable_add(hashtable_t *h, void *key, size_t key_length, void *item) {
+	hashtable_node_t *node = ___hashtable_alloc_node(h);
+		
+	___HASHTABLE_SET_KEY(node, key, key_length); 
+	node->item       = item;
+	node->hash       = h->hash(key, key_length); 
+
+	if (h->old_store) ___hashtable_rehash_step(h); 
+
+	___hashtable_append(___hashtable_bucket(h, node->hash), node); 
 
 	h->count++;
+
+	___hashtable_resize(h); 
 }
 
 void* ___hashtable_remove(hashtable_t *h, void *key, size_t key_length) {
-	int i = ___hashtable_hash(key, key_length, h->store_size); 
+	unsigned int hash = h->hash(key, key_length); 
+
+	if (h->old_store) ___hashtable_rehash_step(h); 
 
-	hashtable_node_t **node_location = h->store + i; 
+	hashtable_node_t **node_location = ___hashtable_bucket(h, hash); 
 	hashtable_node_t  *node          = *node_location; 
-	while(node && !___hashtable_compare_keys(key, key_length, node->key, node->key_length)) {
+	while(node && !___hashtable_matches(node, key, key_length, hash)) {
 		node_location = &(node->next); 
 		node          = *node_location; 
 	}
@@ -81,7 +199,8 @@ void* ___hashtable_remove(hashtable_t *h, void *key, size_t key_length) {
 		void *item = node->item; 
 		*node_location = node->next; 
 		h->count--; 
-		free(node); 
+		___hashtable_free_node(h, node); 
+		___hashtable_resize(h); 
 		return item; 
 	}
 	else {
@@ -91,10 +210,12 @@ void* ___hashtable_remove(hashtable_t *h, void *key, size_t key_length) {
 }
 
 void* ___hashtable_get(hashtable_t *h, void *key, size_t key_length) {
-	int i = ___hashtable_hash(key, key_length, h->store_size); 
+	unsigned int hash = h->hash(key, key_length); 
+
+	if (h->old_store) ___hashtable_rehash_step(h); 
 
-	hashtable_node_t *node = h->store[i]; 
-	while(node && !___hashtable_compare_keys(key, key_length, node->key, node->key_length)) {
+	hashtable_node_t *node = *___hashtable_bucket(h, hash); 
+	while(node && !___hashtable_matches(node, key, key_length, hash)) {
 		node = node->next; 
 	}
 
@@ -106,17 +227,420 @@ int ___hashtable_is_empty (hashtable_t *h) {
 	return h->count == 0;
 }
 
+hashtable_t* create_hashtable_open(int store_size) {
+	return create_hashtable_open_with_hash(store_size, HASHTABLE_HASH_MURMUR3); 
+}
+
+hashtable_t* create_hashtable_open_with_hash(int store_size, hashtable_hash_t hash) {
+	hashtable_t *h = (hashtable_t *)malloc(sizeof(hashtable_t));
+
+	int capacity = ___hashtable_power_of_two(store_size < 8 ? 8 : store_size); 
+	
+	h->hash = ___hashtable_hash_function(hash); 
+	h->store_size = capacity; 
+	h->min_store_size = capacity; 
+	h->store = NULL; 
+	h->entries = calloc(capacity, sizeof(hashtable_entry_t)); 
+	h->old_store = NULL; 
+	h->old_entries = NULL; 
+	h->old_store_size = 0; 
+	h->rehash_index = 0; 
+	h->slabs = NULL; 
+	h->free_nodes = NULL; 
+	h->count = 0;
+
+	h->add      = ___hashtable_open_add; 
+	h->get      = ___hashtable_open_get; 
+	h->remove   = ___hashtable_open_remove; 
+	h->is_empty = ___hashtable_is_empty; 
+	h->destroy  = ___hashtable_open_destroy; 
+	
+	return h;
+}
+
+void ___hashtable_open_destroy(hashtable_t *h) {
+	free(h->entries); 
+	free(h->old_entries); 
+	free(h);
+}
+
+// Places an entry which is known not to be in the table. 
+static void ___hashtable_open_place(hashtable_t *h, hashtable_entry_t entry) {
+	int mask = h->store_size - 1; 
+	int i = entry.hash & mask; 
+
+	entry.distance = 1; 
+	while(h->entries[i].distance) {
+		// Robin Hood: take the slot from an entry which is closer to home. 
+		if (h->entries[i].distance < entry.distance) {
+			hashtable_entry_t displaced = h->entries[i]; 
+			h->entries[i] = entry; 
+			entry = displaced; 
+		}
+		i = (i + 1) & mask; 
+		entry.distance++; 
+	}
+
+	h->entries[i] = entry; 
+}
+
+/*
+  Moves the next few entries of the old array. Moved and removed entries are 
+  left as tombstones, so that searches of the old array still probe past them 
+  and nothing shifts back past rehash_index. 
+ */
+static void ___hashtable_open_rehash_step(hashtable_t *h) {
+	int step; 
+	for (step = 0; step < HASHTABLE_REHASH_STEP && h->rehash_index < h->old_store_size; step++) {
+		hashtable_entry_t *entry = h->old_entries + h->rehash_index++; 
+		if (entry->distance && !(entry->distance & HASHTABLE_TOMBSTONE)) {
+			___hashtable_open_place(h, *entry); 
+			entry->distance |= HASHTABLE_TOMBSTONE; 
+		}
+	}
+
+	if (h->rehash_index == h->old_store_size) {
+		free(h->old_entries); 
+		h->old_entries = NULL; 
+	}
+}
+
+static void ___hashtable_open_grow(hashtable_t *h) {
+	// Growing again before the last move finished; finish it first. 
+	while(h->old_entries) ___hashtable_open_rehash_step(h); 
+
+	h->old_entries = h->entries; 
+	h->old_store_size = h->store_size; 
+	h->rehash_index = 0; 
+	h->store_size = h->store_size * 2; 
+	h->entries = calloc(h->store_size, sizeof(hashtable_entry_t)); 
+}
+
+// Returns the index of the key in entries, or -1. 
+static int ___hashtable_open_find_in(hashtable_entry_t *entries, int store_size, void *key, size_t key_length, unsigned int hash) {
+	int mask = store_size - 1; 
+	int i = hash & mask; 
+	unsigned int distance = 1; 
+
+	// Entries further along are closer to home than this key would be, so it cannot be among them. 
+	// Tombstones compare as far from home, so the search carries on past them. 
+	while(entries[i].distance >= distance) {
+		if (entries[i].hash == hash 
+				&& !(entries[i].distance & HASHTABLE_TOMBSTONE)
+				&& ___hashtable_compare_keys(key, key_length, ___HASHTABLE_KEY(entries + i), entries[i].key_length)) {
+			return i; 
+		}
+		i = (i + 1) & mask; 
+		distance++; 
+	}
+
+	return -1; 
+}
+
+// Returns the entry holding the key in either array, or NULL. 
+static hashtable_entry_t* ___hashtable_open_find(hashtable_t *h, void *key, size_t key_length, unsigned int hash) {
+	int i = ___hashtable_open_find_in(h->entries, h->store_size, key, key_length, hash); 
+	if (i >= 0) return h->entries + i; 
+
+	if (h->old_entries) {
+		i = ___hashtable_open_find_in(h->old_entries, h->old_store_size, key, key_length, hash); 
+		if (i >= 0) return h->old_entries + i; 
+	}
+
+	return NULL; 
+}
+
+void ___hashtable_open_add(hashtable_t *h, void *key, size_t key_length, void *item) {
+	unsigned int hash = h->hash(key, key_length); 
+
+	if (h->old_entries) ___hashtable_open_rehash_step(h); 
+
+	hashtable_entry_t *found = ___hashtable_open_find(h, key, key_length, hash); 
+	if (found) {
+		found->item = item; 
+		return; 
+	}
+
+	if ((h->count + 1) * 8 > h->store_size * 7) ___hashtable_open_grow(h); 
+
+	hashtable_entry_t entry; 
+	___HASHTABLE_SET_KEY(&entry, key, key_length); 
+	entry.item       = item; 
+	entry.hash       = hash; 
+	___hashtable_open_place(h, entry); 
+	h->count++; 
+}
+
+void* ___hashtable_open_get(hashtable_t *h, void *key, size_t key_length) {
+	if (h->old_entries) ___hashtable_open_rehash_step(h); 
+
+	hashtable_entry_t *found = ___hashtable_open_find(h, key, key_length, h->hash(key, key_length)); 
+
+	if (found) return found->item; 
+	else       return NULL; 
+}
+
+void* ___hashtable_open_remove(hashtable_t *h, void *key, size_t key_length) {
+	unsigned int hash = h->hash(key, key_length); 
+
+	if (h->old_entries) ___hashtable_open_rehash_step(h); 
+
+	if (h->old_entries) {
+		int old = ___hashtable_open_find_in(h->old_entries, h->old_store_size, key, key_length, hash); 
+		if (old >= 0) {
+			h->old_entries[old].distance |= HASHTABLE_TOMBSTONE; 
+			h->count--; 
+			return h->old_entries[old].item; 
+		}
+	}
+
+	int i = ___hashtable_open_find_in(h->entries, h->store_size, key, key_length, hash); 
+	if (i < 0) return NULL; 
+
+	void *item = h->entries[i].item; 
+	int mask = h->store_size - 1; 
+	int next = (i + 1) & mask; 
+
+	// Shift the following entries back a slot until one is at home, so no tombstones are needed. 
+	while(h->entries[next].distance > 1) {
+		h->entries[i] = h->entries[next]; 
+		h->entries[i].distance--; 
+		i = next; 
+		next = (next + 1) & mask; 
+	}
+
+	h->entries[i].distance = 0; 
+	h->count--; 
+
+	return item; 
+}
+
+hashtable_concurrent_t* create_hashtable_concurrent(int capacity, size_t value_length) {
+	hashtable_concurrent_t *h = (hashtable_concurrent_t *)malloc(sizeof(hashtable_concurrent_t)); 
+	size_t entry_size = sizeof(hashtable_concurrent_entry_t) + value_length; 
+
+	h->sequence = 0; 
+	h->count = 0; 
+	h->capacity = ___hashtable_power_of_two(capacity < 8 ? 8 : capacity); 
+	h->value_length = value_length; 
+	h->entry_size = (entry_size + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1); 
+	h->entries = calloc(h->capacity, h->entry_size); 
+	h->lock = NULL; 
+	h->unlock = NULL; 
+
+	h->put     = ___hashtable_concurrent_put; 
+	h->get     = ___hashtable_concurrent_get; 
+	h->remove  = ___hashtable_concurrent_remove; 
+	h->destroy = ___hashtable_concurrent_destroy; 
+
+	return h; 
+}
+
+void hashtable_concurrent_set_lock(hashtable_concurrent_t *h, void (*lock)(), void (*unlock)()) {
+	h->lock = lock; 
+	h->unlock = unlock; 
+}
+
+void ___hashtable_concurrent_destroy(hashtable_concurrent_t *h) {
+	free(h->entries); 
+	free(h); 
+}
+
+static hashtable_concurrent_entry_t* ___hashtable_concurrent_slot(hashtable_concurrent_t *h, int i) {
+	return (hashtable_concurrent_entry_t *)(h->entries + i * h->entry_size); 
+}
+
+static void* ___hashtable_concurrent_value(hashtable_concurrent_entry_t *entry) {
+	return (unsigned char *)entry + sizeof(hashtable_concurrent_entry_t); 
+}
+
+// The slot holding the key, or -1. The probe count is bounded so that a reader 
+// racing a writer cannot loop on a table it sees half changed. 
+static int ___hashtable_concurrent_find(hashtable_concurrent_t *h, void *key, size_t key_length, unsigned int hash) {
+	int mask = h->capacity - 1; 
+	int i = hash & mask; 
+	int probes; 
+
+	for (probes = 0; probes < h->capacity; probes++, i = (i + 1) & mask) {
+		hashtable_concurrent_entry_t *entry = ___hashtable_concurrent_slot(h, i); 
+		if (!entry->distance) return -1; 
+		if (entry->hash == hash && ___hashtable_compare_keys(key, key_length, entry->key, entry->key_length)) return i; 
+	}
+
+	return -1; 
+}
+
+static void ___hashtable_concurrent_begin_write(hashtable_concurrent_t *h) {
+	if (h->lock) h->lock(); 
+	h->sequence++; 
+	__sync_synchronize(); 
+}
+
+static void ___hashtable_concurrent_end_write(hashtable_concurrent_t *h) {
+	__sync_synchronize(); 
+	h->sequence++; 
+	if (h->unlock) h->unlock(); 
+}
+
+int ___hashtable_concurrent_put(hashtable_concurrent_t *h, void *key, size_t key_length, void *value) {
+	if (key_length > HASHTABLE_INLINE_KEY_LENGTH) return 0; 
+
+	unsigned int hash = hashtable_hash_murmur3(key, key_length); 
+	int stored = 1; 
+
+	___hashtable_concurrent_begin_write(h); 
+
+	int i = ___hashtable_concurrent_find(h, key, key_length, hash); 
+	if (i < 0) {
+		if ((h->count + 1) * 8 > h->capacity * 7) {
+			stored = 0; 
+		} else {
+			int mask = h->capacity - 1; 
+			unsigned int distance = 1; 
+
+			i = hash & mask; 
+			while (___hashtable_concurrent_slot(h, i)->distance) {
+				i = (i + 1) & mask; 
+				distance++; 
+			}
+
+			hashtable_concurrent_entry_t *entry = ___hashtable_concurrent_slot(h, i); 
+			entry->hash = hash; 
+			entry->key_length = key_length; 
+			memcpy(entry->key, key, key_length); 
+			entry->distance = distance; 
+			h->count++; 
+		}
+	}
+
+	if (stored) memcpy(___hashtable_concurrent_value(___hashtable_concurrent_slot(h, i)), value, h->value_length); 
+
+	___hashtable_concurrent_end_write(h); 
+	return stored; 
+}
+
+int ___hashtable_concurrent_get(hashtable_concurrent_t *h, void *key, size_t key_length, void *value) {
+	if (key_length > HASHTABLE_INLINE_KEY_LENGTH) return 0; 
+
+	unsigned int hash = hashtable_hash_murmur3(key, key_length); 
+	unsigned int sequence; 
+	int i; 
+
+	do {
+		while ((sequence = h->sequence) & 1); 
+		__sync_synchronize(); 
+
+		i = ___hashtable_concurrent_find(h, key, key_length, hash); 
+		if (i >= 0) memcpy(value, ___hashtable_concurrent_value(___hashtable_concurrent_slot(h, i)), h->value_length); 
+
+		__sync_synchronize(); 
+	} while (h->sequence != sequence); 
+
+	return i >= 0; 
+}
+
+int ___hashtable_concurrent_remove(hashtable_concurrent_t *h, void *key, size_t key_length) {
+	if (key_length > HASHTABLE_INLINE_KEY_LENGTH) return 0; 
+
+	unsigned int hash = hashtable_hash_murmur3(key, key_length); 
+	int mask = h->capacity - 1; 
+
+	___hashtable_concurrent_begin_write(h); 
+
+	int i = ___hashtable_concurrent_find(h, key, key_length, hash); 
+	int removed = i >= 0; 
+	if (removed) {
+		// Fill the gap with any later entry in the run which probed past it. 
+		int next = (i + 1) & mask; 
+		hashtable_concurrent_entry_t *entry; 
+		while ((entry = ___hashtable_concurrent_slot(h, next))->distance) {
+			unsigned int shift = (next - i) & mask; 
+			if (entry->distance > shift) {
+				memcpy(___hashtable_concurrent_slot(h, i), entry, h->entry_size); 
+				___hashtable_concurrent_slot(h, i)->distance -= shift; 
+				i = next; 
+			}
+			next = (next + 1) & mask; 
+		}
+		___hashtable_concurrent_slot(h, i)->distance = 0; 
+		h->count--; 
+	}
+
+	___hashtable_concurrent_end_write(h); 
+	return removed; 
+}
+
 int ___hashtable_compare_keys(void *key, size_t key_len, void* key1, size_t key_len1) {
 	if (key_len != key_len1) return 0; 
 	return memcmp(key, key1, key_len) == 0; 
 }
 
-unsigned int ___hashtable_hash(void *key, size_t key_len, int max_key) {
+static inline uint32_t ___hashtable_rotl32(uint32_t x, int r) {
+	return (x << r) | (x >> (32 - r)); 
+}
+
+unsigned int hashtable_hash_murmur3(const void *key, size_t key_length) {
+	const uint8_t *bytes = (const uint8_t *)key; 
+	const uint32_t c1 = 0xcc9e2d51; 
+	const uint32_t c2 = 0x1b873593; 
+	uint32_t hash = 0; 
+	uint32_t k; 
+	size_t i; 
+
+	for (i = 0; i + 4 <= key_length; i += 4) {
+		// Memcpy copes with keys which are not word aligned. 
+		memcpy(&k, bytes + i, sizeof(k)); 
+		k *= c1; 
+		k = ___hashtable_rotl32(k, 15); 
+		k *= c2; 
+		hash ^= k; 
+		hash = ___hashtable_rotl32(hash, 13); 
+		hash = hash * 5 + 0xe6546b64; 
+	}
+
+	k = 0; 
+	switch(key_length & 3) {
+		case 3: k ^= (uint32_t)bytes[i + 2] << 16; 
+			// fall through
+		case 2: k ^= (uint32_t)bytes[i + 1] << 8; 
+			// fall through
+		case 1: k ^= bytes[i]; 
+			k *= c1; 
+			k = ___hashtable_rotl32(k, 15); 
+			k *= c2; 
+			hash ^= k; 
+	}
+
+	hash ^= (uint32_t)key_length; 
+	hash ^= hash >> 16; 
+	hash *= 0x85ebca6b; 
+	hash ^= hash >> 13; 
+	hash *= 0xc2b2ae35; 
+	hash ^= hash >> 16; 
+
+	return hash; 
+}
+
+unsigned int hashtable_hash_fnv1a(const void *key, size_t key_length) {
+	const uint8_t *bytes = (const uint8_t *)key; 
+	uint32_t hash = 2166136261u; 
+	size_t i; 
+
+	for (i = 0; i < key_length; i++) {
+		hash ^= bytes[i]; 
+		hash *= 16777619u; 
+	}
+
+	// FNV leaves the low bits weakest, and stores are indexed by them. 
+	return hash ^ (hash >> 16); 
+}
+
+unsigned int hashtable_hash_shift_xor(const void *key, size_t key_length) {
 	unsigned int hash = 1;
 	int i;
-	for(i = 0; i < key_len; i++) {		
+	for(i = 0; i < key_length; i++) {		
 		hash = (hash << 5) ^ ((char *)key)[i] ^ hash;
 	} 
 
-	return (hash + max_key) % max_key;
+	return hash;
 }
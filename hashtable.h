@@ -19,19 +19,102 @@
 #define HASHTABLE_HH
 #define hashtable_t struct hashtable_t_t
 #define hashtable_node_t struct hashtable_node_t_t
+#define hashtable_entry_t struct hashtable_entry_t_t
+#define hashtable_slab_t struct hashtable_slab_t_t
+#define hashtable_concurrent_t struct hashtable_concurrent_t_t
+#define hashtable_concurrent_entry_t struct hashtable_concurrent_entry_t_t
 #include<sys/types.h>
 #include<stdint.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 
-// Constructor 
+// Buckets, or open entries, moved to the new store by each operation while resizing. 
+#define HASHTABLE_REHASH_STEP 8
+
+// Set in the distance of an old open entry once it has been moved or removed. 
+#define HASHTABLE_TOMBSTONE 0x80000000u
+
+// Keys up to this long are copied into the table, so the caller need not keep 
+// them. Longer keys are referenced and must outlive their entry. 
+#define HASHTABLE_INLINE_KEY_LENGTH 16
+
+// Chained nodes are allocated this many at a time and reused, never freed 
+// until the table is destroyed. 
+#define HASHTABLE_SLAB_NODES 16
+
+/*
+  Hash functions a table can be created with. Stores are a power of two in 
+  size and indexed by the low bits of the hash, so these mix every input bit 
+  into them. 
+  HASHTABLE_HASH_MURMUR3 (MurmurHash3 x86_32) takes four bytes at a time and 
+    is the default. 
+  HASHTABLE_HASH_FNV1A (32 bit FNV-1a) takes a byte at a time, and is cheaper 
+    for keys of a few bytes. 
+  HASHTABLE_HASH_SHIFT_XOR is the original hash, kept for comparison. Its low 
+    bits are poor. 
+ */
+typedef enum {
+	HASHTABLE_HASH_MURMUR3,
+	HASHTABLE_HASH_FNV1A,
+	HASHTABLE_HASH_SHIFT_XOR
+} hashtable_hash_t;
+
+unsigned int hashtable_hash_murmur3   (const void *key, size_t key_length);
+unsigned int hashtable_hash_fnv1a     (const void *key, size_t key_length);
+unsigned int hashtable_hash_shift_xor (const void *key, size_t key_length);
+
+// Constructor. The store is rounded up to a power of two. It doubles when 
+// there are twice as many items as buckets, and halves, but never below its 
+// first size, when it is under 1/8 full. The items are moved across a few 
+// buckets at a time by later operations, so no single one pauses for the 
+// whole table. 
 hashtable_t* create_hashtable(int store_size);
+hashtable_t* create_hashtable_with_hash(int store_size, hashtable_hash_t hash);
+
+// Constructor for a table which keeps its entries inline in one array, using 
+// open addressing with Robin Hood probing. The array is rounded up to a power 
+// of two and doubles, incrementally as above, when it is 7/8 full. Unlike the 
+// chained table, adding a key which is already present replaces its item. 
+hashtable_t* create_hashtable_open(int store_size);
+hashtable_t* create_hashtable_open_with_hash(int store_size, hashtable_hash_t hash);
+
+/*
+  Constructor for a fixed capacity table which may be read from both cores 
+  while one of them updates it. Keys of up to HASHTABLE_INLINE_KEY_LENGTH bytes 
+  and values of value_length bytes are copied into one flat array, rounded up 
+  to a power of two slots, which holds at most 7/8 of its slots. 
+
+  Writers bump a sequence number before and after each change (a seqlock). 
+  Readers copy the value out and retry if the sequence was odd or moved, so 
+  they never block a writer or write to the table themselves, and never see a 
+  half written value. Writers on more than one core or context must be 
+  serialised by lock hooks set with hashtable_concurrent_set_lock; on the 
+  RP2040 a hardware spinlock which also disables interrupts, so that no reader 
+  on the writer's core can spin on a change it has interrupted. 
+ */
+hashtable_concurrent_t* create_hashtable_concurrent(int capacity, size_t value_length); 
+void hashtable_concurrent_set_lock(hashtable_concurrent_t *h, void (*lock)(), void (*unlock)()); 
 
 struct hashtable_t_t {
 	int count;
 	int store_size;
+	int min_store_size;
 	hashtable_node_t **store;	
+	hashtable_entry_t *entries;	
+
+	// The previous store while items are moved out of it, or NULL. Slots 
+	// before rehash_index have been moved. 
+	hashtable_node_t **old_store;
+	hashtable_entry_t *old_entries;
+	int old_store_size;
+	int rehash_index;
+
+	unsigned int (*hash) (const void *key, size_t key_length);
+
+	// Node slabs of a chained table, and the nodes in them not in use. 
+	hashtable_slab_t *slabs;
+	hashtable_node_t *free_nodes;
 
 	// Methods 
 	void  (*add)      (hashtable_t *h, void *key, size_t key_length, void *item);
@@ -43,18 +126,77 @@ struct hashtable_t_t {
 
 struct hashtable_node_t_t {
 	size_t key_length;  
-	void *key;	
+	union {
+		void *key;	
+		unsigned char inline_key[HASHTABLE_INLINE_KEY_LENGTH];
+	};
 	void *item;
+	// The full hash of the key, compared before the key itself. 
+	unsigned int hash;
 	hashtable_node_t *next;
 };
 
+struct hashtable_slab_t_t {
+	hashtable_slab_t *next;
+	hashtable_node_t nodes[HASHTABLE_SLAB_NODES];
+};
+
+struct hashtable_entry_t_t {
+	size_t key_length;  
+	union {
+		void *key;	
+		unsigned char inline_key[HASHTABLE_INLINE_KEY_LENGTH];
+	};
+	void *item;
+	unsigned int hash;
+	// 0 if the entry is empty, otherwise one more than its distance from its home slot. 
+	unsigned int distance;
+};
+
+struct hashtable_concurrent_entry_t_t {
+	unsigned int hash; 
+	// 0 if the entry is empty, otherwise one more than its distance from its home slot.  
+	unsigned int distance; 
+	size_t key_length; 
+	unsigned char key[HASHTABLE_INLINE_KEY_LENGTH]; 
+	// Followed by value_length bytes of value.  
+}; 
+
+struct hashtable_concurrent_t_t {
+	// Odd while a writer is changing the table.  
+	volatile unsigned int sequence; 
+	int count; 
+	int capacity; 
+	size_t value_length; 
+	size_t entry_size; 
+	unsigned char *entries; 
+
+	void (*lock)(); 
+	void (*unlock)(); 
+
+	// Methods. put returns 0 if the key is too long or the table is full, and  
+	// replaces the value of a key already present. get copies the value into  
+	// the buffer and returns 0 if the key is absent.  
+	int   (*put)      (hashtable_concurrent_t *h, void *key, size_t key_length, void *value); 
+	int   (*get)      (hashtable_concurrent_t *h, void *key, size_t key_length, void *value); 
+	int   (*remove)   (hashtable_concurrent_t *h, void *key, size_t key_length); 
+	void  (*destroy)  (hashtable_concurrent_t *h); 
+}; 
+
 // Private
 static void  ___hashtable_add      (hashtable_t *h, void *key, size_t key_length, void *item);
 static void* ___hashtable_remove   (hashtable_t *h, void *key, size_t key_length);
 static void* ___hashtable_get      (hashtable_t *h, void *key, size_t key_length);
 static int   ___hashtable_is_empty (hashtable_t *h);
 static void  ___hashtable_destroy  (hashtable_t *h);
+static void  ___hashtable_open_add      (hashtable_t *h, void *key, size_t key_length, void *item);
+static void* ___hashtable_open_remove   (hashtable_t *h, void *key, size_t key_length);
+static void* ___hashtable_open_get      (hashtable_t *h, void *key, size_t key_length);
+static void  ___hashtable_open_destroy  (hashtable_t *h);
+static int   ___hashtable_concurrent_put     (hashtable_concurrent_t *h, void *key, size_t key_length, void *value); 
+static int   ___hashtable_concurrent_get     (hashtable_concurrent_t *h, void *key, size_t key_length, void *value); 
+static int   ___hashtable_concurrent_remove  (hashtable_concurrent_t *h, void *key, size_t key_length); 
+static void  ___hashtable_concurrent_destroy (hashtable_concurrent_t *h); 
 static int   ___hashtable_compare_keys(void *key, size_t key_len, void* key1, size_t key_len1);
-static unsigned int ___hashtable_hash(void *key, size_t key_len, int max_key);
 
 #endif
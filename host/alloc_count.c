@@ -0,0 +1,72 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    Wrappers which the linker puts in place of the heap functions with
+    --wrap. See alloc_count.h. The counts are not atomic, so only one
+    thread should allocate while they are read.
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#include <malloc.h>
+#include <stdlib.h>
+#include "alloc_count.h"
+
+void* __real_malloc(size_t size); 
+void* __real_calloc(size_t count, size_t size); 
+void* __real_realloc(void *p, size_t size); 
+void  __real_free(void *p); 
+
+static unsigned long calls = 0; 
+static size_t bytes = 0; 
+
+void* __wrap_malloc(size_t size)
+{
+  void *p = __real_malloc(size); 
+  calls++; 
+  if (p)
+    bytes += malloc_usable_size(p); 
+  return p; 
+}
+
+void* __wrap_calloc(size_t count, size_t size)
+{
+  void *p = __real_calloc(count, size); 
+  calls++; 
+  if (p)
+    bytes += malloc_usable_size(p); 
+  return p; 
+}
+
+void* __wrap_realloc(void *p, size_t size)
+{
+  size_t held = p ? malloc_usable_size(p) : 0; 
+  void *q = __real_realloc(p, size); 
+  calls++; 
+  if (q)
+    bytes += malloc_usable_size(q) - held; 
+  return q; 
+}
+
+void __wrap_free(void *p)
+{
+  if (p)
+    bytes -= malloc_usable_size(p); 
+  __real_free(p); 
+}
+
+unsigned long alloc_count_calls() { return calls; }
+size_t alloc_count_bytes() { return bytes; }
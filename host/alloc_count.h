@@ -0,0 +1,42 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    Counts heap calls and the bytes held, for targets built with
+    COUNT_ALLOCATIONS, which links malloc, calloc, realloc and free through
+    alloc_count.c. Only the C allocator is counted, not operator new.
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#ifndef ALLOC_COUNT_HH
+#define ALLOC_COUNT_HH
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Calls to malloc, calloc and realloc since the program started. 
+unsigned long alloc_count_calls(); 
+
+// Bytes currently held, by the allocator's own measure of each block. 
+size_t alloc_count_bytes(); 
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
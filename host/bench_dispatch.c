@@ -0,0 +1,137 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    What a kernel pass costs around the work it dispatches, on the host's
+    real clock, printed as one line of JSON so that runs can be compared:
+
+      passNanos          host time per pass of 8 immediate no-op processes
+      dispatchNanos      host time per process run, including the pass
+      overheadNanos      threadkernel_dispatch_overhead_nanos() for the same run,
+                         which leaves out the time inside the processes
+      hookNanos          extra time per call of beforeProcess or afterProcess
+      timerNanos         host time per timer set and fired
+      doubleAccumulateNanos, integerAccumulateNanos
+                         time to add one execution to a total kept as double
+                         seconds, as process_t did, and as integer microseconds
+
+      bench_dispatch [--quick]
+
+    The accumulator figures flatter the double on a host with an FPU. The
+    RP2040 has none, so there it is a software divide and add.
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#include "host.h"
+
+#define PROCESSES 8
+
+static volatile unsigned long work; 
+static void nop() { work++; }
+static void nop_hook(process_t *process) { (void)process; work++; }
+static void nop_timer(void *context) { (void)context; work++; }
+
+static double pass_nanos(threadkernel_t *k, unsigned long passes)
+{
+  unsigned long i; 
+  uint64_t start = host_nanos(); 
+  for (i = 0; i < passes; i++)
+    k->run(k); 
+
+  return (double)(host_nanos() - start) / passes; 
+}
+
+// Sets a timer due on the next tick each pass, so one fires every pass.
+static double timer_nanos(threadkernel_t *k, unsigned long timers)
+{
+  unsigned long i; 
+  uint64_t start = host_nanos(); 
+  for (i = 0; i < timers; i++)
+  {
+    k->after(k, 0, nop_timer, 0); 
+    timebase_advance_virtual_clock(1000); 
+    k->run(k); 
+  }
+
+  return (double)(host_nanos() - start) / timers; 
+}
+
+int main(int argc, char **argv)
+{
+  unsigned long passes = host_has_flag(argc, argv, "--quick") ? 10000 : 2000000; 
+  unsigned long i; 
+
+  threadkernel_t *plain = create_threadkernel(&host_millis, &host_micros, 0, 0); 
+  threadkernel_t *hooked = create_threadkernel(&host_millis, &host_micros, nop_hook, nop_hook); 
+  CHECK(plain && hooked); 
+
+  for (i = 0; i < PROCESSES; i++)
+    CHECK(plain->addImmediate(plain, nop) && hooked->addImmediate(hooked, nop)); 
+
+  // The hooks cost little beside a pass, so take the best of several
+  // interleaved rounds of each to keep noise out of the difference.
+  double passNanos = 1E9, hookedPassNanos = 1E9; 
+  unsigned int round; 
+  for (round = 0; round < 10; round++)
+  {
+    double nanos = pass_nanos(plain, passes / 10); 
+    if (nanos < passNanos)
+      passNanos = nanos; 
+
+    nanos = pass_nanos(hooked, passes / 10); 
+    if (nanos < hookedPassNanos)
+      hookedPassNanos = nanos; 
+  }
+  double hookNanos = (hookedPassNanos - passNanos) / (2 * PROCESSES); 
+  unsigned long overheadNanos = threadkernel_dispatch_overhead_nanos(plain); 
+
+  // Timers run on an empty kernel on the virtual clock, so nothing else is timed.
+  for (i = 0; i < PROCESSES; i++)
+    plain->remove(plain, plain->firstProcess(plain)); 
+  plain->run(plain); 
+  timebase_use_virtual_clock(0); 
+  plain->millis = &millis64; 
+  plain->micros = &micros64; 
+  unsigned long dispatches = plain->dispatches; 
+  double timerNanos = timer_nanos(plain, passes); 
+  CHECK(plain->dispatches - dispatches == passes); 
+
+  // The same sums of elapsed microseconds, kept both ways.
+  uint64_t elapsed[64]; 
+  for (i = 0; i < 64; i++)
+    elapsed[i] = (i * 7919) % 5000; 
+
+  volatile double seconds = 0; 
+  uint64_t start = host_nanos(); 
+  for (i = 0; i < passes * PROCESSES; i++)
+    seconds = seconds + elapsed[i & 63] / 1E6; 
+  double doubleNanos = (double)(host_nanos() - start) / (passes * PROCESSES); 
+
+  volatile uint64_t micros = 0; 
+  start = host_nanos(); 
+  for (i = 0; i < passes * PROCESSES; i++)
+    micros = micros + elapsed[i & 63]; 
+  double integerNanos = (double)(host_nanos() - start) / (passes * PROCESSES); 
+
+  printf("{\"passes\":%lu,\"processes\":%d,\"passNanos\":%.1f,\"dispatchNanos\":%.2f,"
+         "\"overheadNanos\":%lu,\"hookNanos\":%.2f,\"timerNanos\":%.1f,"
+         "\"doubleAccumulateNanos\":%.2f,\"integerAccumulateNanos\":%.2f}\n",
+    passes, PROCESSES, passNanos, passNanos / PROCESSES,
+    overheadNanos, hookNanos, timerNanos,
+    doubleNanos, integerNanos); 
+
+  return 0; 
+}
@@ -0,0 +1,139 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    Throughput of each hash function over thermostat names and 8 byte
+    OneWire addresses, and get time of chained and open addressing tables
+    created with each, so that a faster hash which clusters keys shows up as
+    slower gets.
+
+      bench_hash [--quick]
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#include "host.h"
+#include <hashtable.h>
+
+#define KEYS 1024
+
+typedef unsigned int (*hash_function_t)(const void *key, size_t key_length); 
+
+static const char *rooms[] = { "living", "bedroom", "office", "kitchen", "basement", "attic", "garage", "hall" }; 
+
+static char names[KEYS][16]; 
+static int nameLengths[KEYS]; 
+static size_t nameBytes = 0; 
+static unsigned char addresses[KEYS][8]; 
+
+static volatile unsigned int sink; 
+
+static void make_keys()
+{
+	int i; 
+	for (i = 0; i < KEYS; i++)
+	{
+		nameLengths[i] = snprintf(names[i], sizeof(names[i]), "%s%d", rooms[i % 8], i / 8); 
+		nameBytes += nameLengths[i]; 
+
+		// Family code 0x28, a serial number, and a CRC like byte, like a DS18B20.
+		unsigned char address[8] = { 0x28, 0xFF, 0x12, 0x34, i & 0xFF, i >> 8, 0x04, i * 7 }; 
+		memcpy(addresses[i], address, 8); 
+	}
+}
+
+static void bench_function(const char *name, hash_function_t hash, int rounds)
+{
+	int i, round; 
+	unsigned int sum = 0; 
+
+	uint64_t start = host_nanos(); 
+	for (round = 0; round < rounds; round++)
+		for (i = 0; i < KEYS; i++)
+			sum += hash(names[i], nameLengths[i]); 
+	uint64_t nameNanos = host_nanos() - start; 
+
+	start = host_nanos(); 
+	for (round = 0; round < rounds; round++)
+		for (i = 0; i < KEYS; i++)
+			sum += hash(addresses[i], 8); 
+	uint64_t addressNanos = host_nanos() - start; 
+
+	sink = sum; 
+
+	double hashes = (double)KEYS * rounds; 
+	printf("%-10s %10.1f %10.0f %10.1f %10.0f\n", name,
+		nameNanos / hashes, (double)nameBytes * rounds * 1E3 / nameNanos,
+		addressNanos / hashes, 8.0 * KEYS * rounds * 1E3 / addressNanos); 
+}
+
+static void bench_table(const char *name, hashtable_t *(*create)(int, hashtable_hash_t), hashtable_hash_t hash, int rounds)
+{
+	int i, round; 
+	uintptr_t sum = 0; 
+	hashtable_t *h = create(KEYS * 2, hash); 
+
+	for (i = 0; i < KEYS; i++)
+	{
+		h->add(h, names[i], nameLengths[i], (void *)(intptr_t)(i + 1)); 
+		h->add(h, addresses[i], 8, (void *)(intptr_t)(i + 1)); 
+	}
+
+	uint64_t start = host_nanos(); 
+	for (round = 0; round < rounds; round++)
+		for (i = 0; i < KEYS; i++)
+			sum += (uintptr_t)h->get(h, names[i], nameLengths[i]); 
+	uint64_t nameNanos = host_nanos() - start; 
+
+	start = host_nanos(); 
+	for (round = 0; round < rounds; round++)
+		for (i = 0; i < KEYS; i++)
+			sum += (uintptr_t)h->get(h, addresses[i], 8); 
+	uint64_t addressNanos = host_nanos() - start; 
+
+	// Each key was found once a round, under both its name and its address.
+	CHECK(sum == (uintptr_t)rounds * KEYS * (KEYS + 1)); 
+	h->destroy(h); 
+
+	double gets = (double)KEYS * rounds; 
+	printf("%-10s %10.1f %10.1f\n", name, nameNanos / gets, addressNanos / gets); 
+}
+
+int main(int argc, char **argv)
+{
+	int quick = host_has_flag(argc, argv, "--quick"); 
+	int rounds = quick ? 100 : 20000; 
+
+	make_keys(); 
+
+	printf("%-10s %10s %10s %10s %10s\n", "hash", "name ns", "name MB/s", "addr ns", "addr MB/s"); 
+	bench_function("murmur3", hashtable_hash_murmur3, rounds); 
+	bench_function("fnv1a", hashtable_hash_fnv1a, rounds); 
+	bench_function("shift_xor", hashtable_hash_shift_xor, rounds); 
+
+	const char *hashNames[] = { "murmur3", "fnv1a", "shift_xor" }; 
+	hashtable_hash_t hashes[] = { HASHTABLE_HASH_MURMUR3, HASHTABLE_HASH_FNV1A, HASHTABLE_HASH_SHIFT_XOR }; 
+	int i; 
+
+	printf("\n%-10s %10s %10s\n", "chained", "name get", "addr get"); 
+	for (i = 0; i < 3; i++)
+		bench_table(hashNames[i], create_hashtable_with_hash, hashes[i], rounds / 4 + 1); 
+
+	printf("\n%-10s %10s %10s\n", "open", "name get", "addr get"); 
+	for (i = 0; i < 3; i++)
+		bench_table(hashNames[i], create_hashtable_open_with_hash, hashes[i], rounds / 4 + 1); 
+
+	return 0; 
+}
@@ -0,0 +1,127 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    Insert, lookup and erase time of AOS::HashMap against std::map and
+    std::unordered_map for the key types the sketch uses: uint8_t indexes,
+    thermostat names and 8 byte OneWire addresses, at the small sizes it
+    holds. Times are of the fastest round.
+
+      bench_hashmap [--quick]
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include "host.h"
+#include <HashMap.h>
+
+typedef std::array<uint8_t, 8> Address; 
+
+// std::unordered_map has no hash for std::array.
+struct AddressHash
+{
+  size_t operator()(const Address& a) const { return AOS::HashMapKey<Address>::hash(a); }; 
+}; 
+
+static volatile long sink; 
+
+struct Times
+{
+  double insert; 
+  double find; 
+  double erase; 
+}; 
+
+template <typename Map, typename K>
+static Times bench(const std::vector<K>& keys, int rounds)
+{
+  Times best = { 1E30, 1E30, 1E30 }; 
+  double n = keys.size(); 
+  long sum = 0; 
+
+  for (int round = 0; round < rounds; round++)
+  {
+    Map map; 
+
+    uint64_t start = host_nanos(); 
+    for (const K& key : keys)
+      map[key] = 1; 
+    best.insert = std::min(best.insert, (host_nanos() - start) / n); 
+
+    // Enough lookups to time, as the maps are small.
+    start = host_nanos(); 
+    for (int i = 0; i < 100; i++)
+      for (const K& key : keys)
+        sum += map.count(key); 
+    best.find = std::min(best.find, (host_nanos() - start) / (n * 100)); 
+
+    start = host_nanos(); 
+    for (const K& key : keys)
+      sum += map.erase(key); 
+    best.erase = std::min(best.erase, (host_nanos() - start) / n); 
+
+    CHECK(map.size() == 0); 
+  }
+
+  CHECK(sum == (long)keys.size() * 101 * rounds); 
+  sink = sum; 
+  return best; 
+}
+
+template <typename K, typename Hash = std::hash<K>>
+static void compare(const char* name, const std::vector<K>& keys, int rounds)
+{
+  Times ordered = bench<std::map<K, int>>(keys, rounds); 
+  Times unordered = bench<std::unordered_map<K, int, Hash>>(keys, rounds); 
+  Times hashMap = bench<AOS::HashMap<K, int>>(keys, rounds); 
+
+  printf("%-8s %5zu %-7s %8.1f %8.1f %8.1f\n", name, keys.size(), "insert", ordered.insert, unordered.insert, hashMap.insert); 
+  printf("%-8s %5zu %-7s %8.1f %8.1f %8.1f\n", name, keys.size(), "find", ordered.find, unordered.find, hashMap.find); 
+  printf("%-8s %5zu %-7s %8.1f %8.1f %8.1f\n", name, keys.size(), "erase", ordered.erase, unordered.erase, hashMap.erase); 
+}
+
+int main(int argc, char** argv)
+{
+  int rounds = host_has_flag(argc, argv, "--quick") ? 10 : 500; 
+  const char* rooms[] = { "living", "bedroom", "office", "kitchen", "basement", "attic", "garage", "hall" }; 
+
+  printf("%-8s %5s %-7s %8s %8s %8s\n", "key", "n", "ns/op", "map", "umap", "HashMap"); 
+
+  for (size_t n : { 8, 64, 256 })
+  {
+    std::vector<uint8_t> indexes; 
+    std::vector<std::string> names; 
+    std::vector<Address> addresses; 
+
+    for (size_t i = 0; i < n; i++)
+    {
+      indexes.push_back((uint8_t)(i * 7)); 
+      names.push_back(std::string(rooms[i % 8]) + std::to_string(i / 8)); 
+
+      // Family code 0x28, a serial number, and a CRC like byte, like a DS18B20.
+      addresses.push_back(Address{0x28, 0xFF, 0x12, 0x34, (uint8_t)i, (uint8_t)(i >> 8), 0x04, (uint8_t)(i * 7)}); 
+    }
+
+    compare("uint8_t", indexes, rounds); 
+    compare("string", names, rounds); 
+    compare<Address, AddressHash>("address", addresses, rounds); 
+  }
+
+  return 0; 
+}
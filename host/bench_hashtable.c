@@ -0,0 +1,103 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    Insert, get and remove throughput of the chained and open addressing
+    hashtable_t modes, and the heap each uses, at a few table sizes. Keys are
+    8 byte OneWire style addresses. Tables start small and grow as they fill.
+
+      bench_hashtable [--quick]
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#include "host.h"
+#include "alloc_count.h"
+#include <hashtable.h>
+
+static const int sizes[] = { 100, 1000, 10000, 100000 }; 
+
+static uint64_t *keys; 
+
+static void run(const char *mode, hashtable_t *(*create)(int), int n, int rounds)
+{
+	int i, round; 
+	uint64_t insertNanos = 0, getNanos = 0, missNanos = 0, removeNanos = 0; 
+	size_t bytes = 0; 
+	uintptr_t sum = 0; 
+
+	for (round = 0; round < rounds; round++)
+	{
+		size_t before = alloc_count_bytes(); 
+		hashtable_t *h = create(8); 
+
+		uint64_t start = host_nanos(); 
+		for (i = 0; i < n; i++)
+			h->add(h, &keys[i], sizeof(uint64_t), (void *)(intptr_t)(i + 1)); 
+		insertNanos += host_nanos() - start; 
+
+		bytes = alloc_count_bytes() - before; 
+
+		start = host_nanos(); 
+		for (i = 0; i < n; i++)
+			sum += (uintptr_t)h->get(h, &keys[(i * 7919) % n], sizeof(uint64_t)); 
+		getNanos += host_nanos() - start; 
+
+		start = host_nanos(); 
+		for (i = 0; i < n; i++)
+			sum += (uintptr_t)h->get(h, &keys[n + i], sizeof(uint64_t)); 
+		missNanos += host_nanos() - start; 
+
+		start = host_nanos(); 
+		for (i = 0; i < n; i++)
+			sum -= (uintptr_t)h->remove(h, &keys[i], sizeof(uint64_t)); 
+		removeNanos += host_nanos() - start; 
+
+		CHECK(h->count == 0); 
+		h->destroy(h); 
+	}
+
+	double ops = (double)n * rounds; 
+	printf("%-8s %8d %10.1f %10.1f %10.1f %10.1f %10zu %8.1f\n", mode, n, 
+		insertNanos / ops, getNanos / ops, missNanos / ops, removeNanos / ops, 
+		bytes, (double)bytes / n); 
+
+	// Every get hit was taken away again by its remove, and misses add nothing. 
+	CHECK(sum == 0); 
+}
+
+int main(int argc, char **argv)
+{
+	int quick = host_has_flag(argc, argv, "--quick"); 
+	int maxKeys = quick ? 1000 : sizes[sizeof(sizes) / sizeof(sizes[0]) - 1]; 
+	unsigned int i; 
+
+	// Family code 0x28, a serial number, and a CRC byte, like a DS18B20. 
+	keys = malloc(2 * maxKeys * sizeof(uint64_t)); 
+	for (i = 0; i < 2 * (unsigned int)maxKeys; i++)
+		keys[i] = 0x28ULL | ((uint64_t)(i * 2654435761u) << 8) | ((uint64_t)(i & 0xFF) << 56); 
+
+	printf("%-8s %8s %10s %10s %10s %10s %10s %8s\n", 
+		"mode", "entries", "insert ns", "get ns", "miss ns", "remove ns", "heap B", "B/entry"); 
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]) && sizes[i] <= maxKeys; i++)
+	{
+		int rounds = (quick ? 10000 : 2000000) / sizes[i] + 1; 
+		run("chained", create_hashtable, sizes[i], rounds); 
+		run("open", create_hashtable_open, sizes[i], rounds); 
+	}
+
+	free(keys); 
+	return 0; 
+}
@@ -0,0 +1,188 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    Steady state add and remove churn, and gets, on a chained table, with
+    8 byte keys held inline in the nodes and 24 byte keys held by pointer.
+    Once the table has filled, nodes come from its slabs' free list, so the
+    churn must make no heap calls at all, which is checked. Times are of the
+    fastest round. Cache misses are counted with perf_event_open where the
+    kernel allows it.
+
+      bench_hashtable_nodes [--quick]
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "host.h"
+#include "alloc_count.h"
+#include <hashtable.h>
+
+#define LONG_KEY_LENGTH 24
+
+static unsigned char *keys; 
+static int cacheMisses = -1; 
+
+static void open_cache_misses()
+{
+	struct perf_event_attr attr; 
+	memset(&attr, 0, sizeof(attr)); 
+	attr.size = sizeof(attr); 
+	attr.type = PERF_TYPE_HARDWARE; 
+	attr.config = PERF_COUNT_HW_CACHE_MISSES; 
+	attr.disabled = 1; 
+	attr.exclude_kernel = 1; 
+	attr.exclude_hv = 1; 
+
+	cacheMisses = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0); 
+}
+
+static void start_cache_misses()
+{
+	if (cacheMisses < 0)
+		return; 
+	ioctl(cacheMisses, PERF_EVENT_IOC_RESET, 0); 
+	ioctl(cacheMisses, PERF_EVENT_IOC_ENABLE, 0); 
+}
+
+// Misses since start_cache_misses(), or -1 if they cannot be counted.
+static long long stop_cache_misses()
+{
+	long long count; 
+	if (cacheMisses < 0)
+		return -1; 
+	ioctl(cacheMisses, PERF_EVENT_IOC_DISABLE, 0); 
+	if (read(cacheMisses, &count, sizeof(count)) != sizeof(count))
+		return -1; 
+	return count; 
+}
+
+static unsigned char *key(int i, int keyLength)
+{
+	return keys + (size_t)i * keyLength; 
+}
+
+static uint64_t min_nanos(uint64_t a, uint64_t b)
+{
+	return a < b ? a : b; 
+}
+
+// Time is of the fastest round, so that preemption does not count; misses are a round's average. 
+static void print_row(const char *name, int keyLength, const char *op, uint64_t nanos, long ops, long long misses, unsigned long calls)
+{
+	if (misses < 0)
+		printf("%-8s %4d %-8s %10.1f %12s %10lu\n", name, keyLength, op, (double)nanos / ops, "-", calls); 
+	else
+		printf("%-8s %4d %-8s %10.1f %12.3f %10lu\n", name, keyLength, op, (double)nanos / ops, (double)misses / ops, calls); 
+}
+
+static void run(const char *name, int keyLength, int n, int rounds)
+{
+	int i, round; 
+	uintptr_t sum = 0; 
+	hashtable_t *h = create_hashtable(8); 
+
+	for (i = 0; i < n; i++)
+		h->add(h, key(i, keyLength), keyLength, (void *)(intptr_t)(i + 1)); 
+
+	// One round of churn to finish any incremental resize and fill the free list.
+	for (i = 0; i < n; i++)
+	{
+		h->remove(h, key(i, keyLength), keyLength); 
+		h->add(h, key(n + i, keyLength), keyLength, (void *)(intptr_t)(n + i + 1)); 
+	}
+
+	// The live keys slide through keys [n, 2n) and back to [0, n).
+	unsigned long calls = alloc_count_calls(); 
+	start_cache_misses(); 
+	uint64_t churnNanos = UINT64_MAX; 
+	for (round = 0; round < rounds; round++)
+	{
+		int from = (round & 1) ? 0 : n, to = n - from; 
+		uint64_t start = host_nanos(); 
+		for (i = 0; i < n; i++)
+		{
+			sum += (uintptr_t)h->remove(h, key(from + i, keyLength), keyLength); 
+			h->add(h, key(to + i, keyLength), keyLength, (void *)(intptr_t)(to + i + 1)); 
+		}
+		churnNanos = min_nanos(churnNanos, host_nanos() - start); 
+	}
+	long long churnMisses = stop_cache_misses(); 
+	unsigned long churnCalls = alloc_count_calls() - calls; 
+
+	int live = (rounds & 1) ? 0 : n; 
+	calls = alloc_count_calls(); 
+	start_cache_misses(); 
+	uint64_t getNanos = UINT64_MAX; 
+	for (round = 0; round < rounds; round++)
+	{
+		uint64_t start = host_nanos(); 
+		for (i = 0; i < n; i++)
+			sum += (uintptr_t)h->get(h, key(live + (i * 7919) % n, keyLength), keyLength); 
+		getNanos = min_nanos(getNanos, host_nanos() - start); 
+	}
+	long long getMisses = stop_cache_misses(); 
+	unsigned long getCalls = alloc_count_calls() - calls; 
+
+	CHECK(h->count == n); 
+	CHECK(sum != 0); 
+	h->destroy(h); 
+
+	print_row(name, keyLength, "churn", churnNanos, n, churnMisses < 0 ? -1 : churnMisses / rounds, churnCalls); 
+	print_row(name, keyLength, "get", getNanos, n, getMisses < 0 ? -1 : getMisses / rounds, getCalls); 
+
+	CHECK(churnCalls == 0); 
+	CHECK(getCalls == 0); 
+}
+
+int main(int argc, char **argv)
+{
+	int quick = host_has_flag(argc, argv, "--quick"); 
+	int n = quick ? 1000 : 100000; 
+	int rounds = quick ? 10 : 20; 
+	int i, l; 
+
+	// Family code 0x28, a serial number, and a CRC byte, like a DS18B20, padded
+	// out with a prefix for the long keys.
+	keys = malloc((size_t)2 * n * LONG_KEY_LENGTH); 
+
+	open_cache_misses(); 
+	if (cacheMisses < 0)
+		printf("cache misses cannot be counted here\n"); 
+
+	printf("%-8s %4s %-8s %10s %12s %10s\n", "keys", "B", "op", "ns/op", "misses/op", "heap calls"); 
+	int lengths[] = { 8, LONG_KEY_LENGTH }; 
+	for (l = 0; l < 2; l++)
+	{
+		int keyLength = lengths[l]; 
+		for (i = 0; i < 2 * n; i++)
+		{
+			unsigned char *k = key(i, keyLength); 
+			uint64_t address = 0x28ULL | ((uint64_t)(i * 2654435761u) << 8) | ((uint64_t)(i & 0xFF) << 56); 
+			memset(k, 'a', keyLength); 
+			memcpy(k + keyLength - 8, &address, 8); 
+		}
+		run(keyLength <= HASHTABLE_INLINE_KEY_LENGTH ? "inline" : "pointer", keyLength, n, rounds); 
+	}
+
+	if (cacheMisses >= 0)
+		close(cacheMisses); 
+	free(keys); 
+	return 0; 
+}
@@ -0,0 +1,90 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    Shows that growing tables keep lookups flat and adds short: get latency
+    of both hashtable_t modes, started at 16 buckets, as they fill from 10
+    to 100000 entries, and the spread of single add times while filling to
+    100000, when every resize happens along the way. The longest add on a
+    host includes any time the OS took the CPU away, so the 99.9th
+    percentile is the one to compare.
+
+      bench_hashtable_resize [--quick]
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#include "host.h"
+#include <hashtable.h>
+
+#define MAX_ENTRIES 100000
+
+static const int sizes[] = { 10, 100, 1000, 10000, 100000 }; 
+
+static uint32_t keys[MAX_ENTRIES]; 
+static uint32_t addNanos[MAX_ENTRIES]; 
+
+static int compare_nanos(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b; 
+	return x < y ? -1 : x > y; 
+}
+
+static void run(const char *mode, hashtable_t *(*create)(int), int maxEntries, long lookups)
+{
+	hashtable_t *h = create(16); 
+	int added = 0; 
+	unsigned int s; 
+	uintptr_t sum = 0; 
+
+	printf("%-8s get ns:", mode); 
+	for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]) && sizes[s] <= maxEntries; s++)
+	{
+		for (; added < sizes[s]; added++)
+		{
+			uint64_t start = host_nanos(); 
+			h->add(h, &keys[added], sizeof(uint32_t), (void *)(intptr_t)(added + 1)); 
+			addNanos[added] = (uint32_t)(host_nanos() - start); 
+		}
+
+		long i; 
+		uint64_t start = host_nanos(); 
+		for (i = 0; i < lookups; i++)
+			sum += (uintptr_t)h->get(h, &keys[(i * 7919) % added], sizeof(uint32_t)); 
+		printf(" %d:%.1f", added, (double)(host_nanos() - start) / lookups); 
+	}
+	CHECK(sum); 
+
+	qsort(addNanos, added, sizeof(uint32_t), compare_nanos); 
+	printf("\n%-8s add ns: p50 %u p99 %u p99.9 %u max %u over %d adds, store %d\n", mode,
+		addNanos[added / 2], addNanos[added * 99 / 100], addNanos[added * 999 / 1000],
+		addNanos[added - 1], added, h->store_size); 
+
+	h->destroy(h); 
+}
+
+int main(int argc, char **argv)
+{
+	int quick = host_has_flag(argc, argv, "--quick"); 
+	int i; 
+
+	for (i = 0; i < MAX_ENTRIES; i++)
+		keys[i] = i * 2654435761u; 
+
+	run("chained", create_hashtable, quick ? 1000 : MAX_ENTRIES, quick ? 10000 : 2000000); 
+	run("open", create_hashtable_open, quick ? 1000 : MAX_ENTRIES, quick ? 10000 : 2000000); 
+
+	return 0; 
+}
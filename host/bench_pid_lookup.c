@@ -0,0 +1,84 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    Cost of getProcessByPid with 10, 100 and 1000 processes, beside a walk of
+    the process list as lookups were done before pids indexed the pool.
+
+      bench_pid_lookup [--quick]
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#include "host.h"
+
+static const unsigned int processCounts[] = { 10, 100, 1000 }; 
+
+static void nop() { }
+
+// Keeps the lookups from being optimised away.
+static process_t * volatile found; 
+
+static process_t* find_by_walk(threadkernel_t *k, unsigned int pid)
+{
+  process_t *process; 
+  for (process = k->firstProcess(k); process; process = k->nextProcess(k, process))
+  {
+    if (process->pid == pid)
+      return process; 
+  }
+  return 0; 
+}
+
+int main(int argc, char **argv)
+{
+  unsigned long lookups = host_has_flag(argc, argv, "--quick") ? 10000 : 10000000; 
+  unsigned int pids[1000]; 
+  unsigned int c, i; 
+  unsigned long l; 
+
+  timebase_use_virtual_clock(0); 
+
+  printf("%10s %12s %12s\n", "processes", "table ns", "walk ns"); 
+  for (c = 0; c < sizeof(processCounts) / sizeof(processCounts[0]); c++)
+  {
+    unsigned int count = processCounts[c]; 
+    threadkernel_t *k = create_threadkernel(&millis64, &micros64, 0, 0); 
+    CHECK(k); 
+
+    for (i = 0; i < count; i++)
+    {
+      process_t *process = i % 4 ? k->add(k, nop, 1000) : k->addImmediate(k, nop); 
+      CHECK(process); 
+      pids[i] = process->pid; 
+    }
+
+    // Look up the processes in a scattered order, so the walks average half the list.
+    uint64_t start = host_nanos(); 
+    for (l = 0; l < lookups; l++)
+      found = k->getProcessByPid(k, pids[(l * 7919) % count]); 
+    double tableNanos = (double)(host_nanos() - start) / lookups; 
+
+    unsigned long walks = lookups / count + count; 
+    start = host_nanos(); 
+    for (l = 0; l < walks; l++)
+      found = find_by_walk(k, pids[(l * 7919) % count]); 
+    double walkNanos = (double)(host_nanos() - start) / walks; 
+
+    printf("%10u %12.2f %12.2f\n", count, tableNanos, walkNanos); 
+  }
+
+  return 0; 
+}
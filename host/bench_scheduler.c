@@ -0,0 +1,76 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    Host time per kernel pass against the number of periodic processes, for
+    each scheduler. The processes do nothing, have periods of 10ms to 1s and
+    two immediate processes run beside them, so the figures are the
+    scheduler's own cost. The virtual clock moves on 1ms a pass.
+
+      bench_scheduler [--quick]
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#include "host.h"
+
+static const unsigned int taskCounts[] = { 8, 16, 32, 64, 128, 256 }; 
+static const unsigned long periods[] = { 10, 50, 100, 250, 1000 }; 
+
+static void nop() { }
+
+static double nanos_per_pass(threadkernel_scheduler_t scheduler, unsigned int tasks, unsigned long passes)
+{
+  unsigned int i; 
+  timebase_use_virtual_clock(0); 
+
+  threadkernel_t *k = create_threadkernel_with_scheduler(&millis64, &micros64, 0, 0, scheduler); 
+  CHECK(k); 
+  CHECK(k->addImmediate(k, nop)); 
+  CHECK(k->addImmediate(k, nop)); 
+
+  // Stagger the processes so that they do not all fall due together.
+  for (i = 0; i < tasks; i++)
+  {
+    CHECK(k->add(k, nop, periods[i % 5])); 
+    timebase_advance_virtual_clock(1000 * (i % 7)); 
+  }
+
+  uint64_t start = host_nanos(); 
+  for (i = 0; i < passes; i++)
+  {
+    k->run(k); 
+    timebase_advance_virtual_clock(1000); 
+  }
+
+  return (double)(host_nanos() - start) / passes; 
+}
+
+int main(int argc, char **argv)
+{
+  unsigned long passes = host_has_flag(argc, argv, "--quick") ? 2000 : 200000; 
+  unsigned int i; 
+
+  printf("%8s %12s %12s %12s\n", "tasks", "list ns", "heap ns", "edf ns"); 
+  for (i = 0; i < sizeof(taskCounts) / sizeof(taskCounts[0]); i++)
+  {
+    printf("%8u %12.1f %12.1f %12.1f\n", taskCounts[i],
+      nanos_per_pass(THREADKERNEL_SCHEDULER_LIST, taskCounts[i], passes),
+      nanos_per_pass(THREADKERNEL_SCHEDULER_HEAP, taskCounts[i], passes),
+      nanos_per_pass(THREADKERNEL_SCHEDULER_EDF, taskCounts[i], passes)); 
+  }
+
+  return 0; 
+}
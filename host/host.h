@@ -0,0 +1,88 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    Helpers shared by the host simulator, tests and benchmarks.
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#ifndef HOST_HH
+#define HOST_HH
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <timebase.h>
+#include <threadkernel.h>
+#ifdef __cplusplus
+}
+#endif
+
+// Fails the test, naming the condition, when it does not hold.
+#define CHECK(condition) do { \
+    if (!(condition)) \
+    { \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+      exit(1); \
+    } \
+  } while(0)
+
+// Monotonic wall clock time, for benchmarks.
+static inline uint64_t host_nanos()
+{
+  struct timespec t; 
+  clock_gettime(CLOCK_MONOTONIC, &t); 
+  return (uint64_t)t.tv_sec * 1000000000ULL + (uint64_t)t.tv_nsec; 
+}
+
+static inline uint64_t host_micros() { return host_nanos() / 1000; }
+static inline uint64_t host_millis() { return host_nanos() / 1000000; }
+
+// Spins, rather than sleeping, for the given wall clock time.
+static inline void host_spin_micros(uint64_t micros)
+{
+  uint64_t end = host_micros() + micros; 
+  while(host_micros() < end); 
+}
+
+/*
+  onIdle hook for kernels on the virtual clock: skips straight to the time the
+  kernel next has something to do, or by a second if it has nothing at all.
+ */
+static inline void host_virtual_idle(threadkernel_t *k, uint64_t milliseconds)
+{
+  (void)k; 
+  timebase_advance_virtual_clock(milliseconds == UINT64_MAX ? 1000000 : milliseconds * 1000); 
+}
+
+// Whether the command line holds the given flag, such as --quick.
+static inline int host_has_flag(int argc, char **argv, const char *flag)
+{
+  int i; 
+  for (i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], flag))
+      return 1; 
+  }
+  return 0; 
+}
+
+#endif
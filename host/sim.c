@@ -0,0 +1,288 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    Runs a scripted workload through threadkernel on the virtual clock and
+    reports throughput, lateness, skipped executions and deadline misses.
+
+      aos_sim [--json] [--max-skipped N] [--max-missed N] [--max-late-p99 MS] [workload]
+
+    The workload is read from the named file, or stdin, one directive a line:
+
+      scheduler list|heap|edf
+      duration  <ms of virtual time>
+      overhead  <us each kernel pass costs>
+      periodic  <count> <period ms> <cost us>[-<max cost us>] [<deadline ms>]
+      immediate <count> <cost us>[-<max cost us>]
+
+    A cost range is drawn from a fixed seed, so every run of a workload is the
+    same. With any of the --max options, the exit status is 1 if a limit is
+    exceeded, so workloads can be used as regression tests.
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#include <limits.h>
+#include "host.h"
+
+#define SIM_MAX_GROUPS 32
+
+#define sim_group_t struct sim_group_t_t
+
+struct sim_group_t_t
+{
+  unsigned int  count; 
+  unsigned long periodMilliseconds; 
+  unsigned long deadlineMilliseconds; 
+  unsigned long minCostMicros; 
+  unsigned long maxCostMicros; 
+  unsigned char immediate; 
+}; 
+
+static sim_group_t   groups[SIM_MAX_GROUPS]; 
+static unsigned int  groupCount = 0; 
+static threadkernel_scheduler_t scheduler = THREADKERNEL_SCHEDULER_LIST; 
+static unsigned long durationMillis = 10000; 
+static unsigned long overheadMicros = 1; 
+static uint32_t      seed = 1; 
+
+static uint32_t next_random()
+{
+  seed = seed * 1664525 + 1013904223; 
+  return seed >> 8; 
+}
+
+static void run_group_process(void *context)
+{
+  sim_group_t *group = (sim_group_t *)context; 
+  unsigned long cost = group->minCostMicros; 
+
+  if (group->maxCostMicros > group->minCostMicros)
+    cost += next_random() % (group->maxCostMicros - group->minCostMicros + 1); 
+
+  timebase_advance_virtual_clock(cost); 
+}
+
+static int parse_cost(const char *text, sim_group_t *group)
+{
+  if (sscanf(text, "%lu-%lu", &group->minCostMicros, &group->maxCostMicros) == 2)
+    return group->maxCostMicros >= group->minCostMicros; 
+
+  if (sscanf(text, "%lu", &group->minCostMicros) != 1)
+    return 0; 
+
+  group->maxCostMicros = group->minCostMicros; 
+  return 1; 
+}
+
+static int parse_line(char *line)
+{
+  char directive[16], name[16], cost[32]; 
+  sim_group_t group; 
+  memset(&group, 0, sizeof(group)); 
+
+  char *comment = strchr(line, '#'); 
+  if (comment)
+    *comment = 0;
+
+  if (sscanf(line, "%15s", directive) != 1)
+    return 1; 
+
+  if (!strcmp(directive, "scheduler") && sscanf(line, "%*s %15s", name) == 1)
+  {
+    if (!strcmp(name, "list"))
+      scheduler = THREADKERNEL_SCHEDULER_LIST; 
+    else if (!strcmp(name, "heap"))
+      scheduler = THREADKERNEL_SCHEDULER_HEAP; 
+    else if (!strcmp(name, "edf"))
+      scheduler = THREADKERNEL_SCHEDULER_EDF; 
+    else
+      return 0; 
+    return 1; 
+  }
+
+  if (!strcmp(directive, "duration"))
+    return sscanf(line, "%*s %lu", &durationMillis) == 1; 
+
+  if (!strcmp(directive, "overhead"))
+    return sscanf(line, "%*s %lu", &overheadMicros) == 1; 
+
+  if (!strcmp(directive, "periodic"))
+  {
+    int fields = sscanf(line, "%*s %u %lu %31s %lu", &group.count, &group.periodMilliseconds, cost, &group.deadlineMilliseconds); 
+    if (fields < 3 || !parse_cost(cost, &group))
+      return 0; 
+  }
+  else if (!strcmp(directive, "immediate"))
+  {
+    if (sscanf(line, "%*s %u %31s", &group.count, cost) != 2 || !parse_cost(cost, &group))
+      return 0; 
+    group.immediate = 1; 
+  }
+  else
+  {
+    return 0; 
+  }
+
+  if (groupCount >= SIM_MAX_GROUPS)
+    return 0; 
+
+  groups[groupCount++] = group; 
+  return 1; 
+}
+
+static int read_workload(FILE *in)
+{
+  char line[256]; 
+  unsigned int lineNumber = 0; 
+
+  while(fgets(line, sizeof(line), in))
+  {
+    lineNumber++; 
+    if (!parse_line(line))
+    {
+      fprintf(stderr, "line %u: cannot parse: %s", lineNumber, line); 
+      return 0; 
+    }
+  }
+
+  return 1; 
+}
+
+static const char* scheduler_name()
+{
+  switch(scheduler)
+  {
+    case THREADKERNEL_SCHEDULER_HEAP: return "heap"; 
+    case THREADKERNEL_SCHEDULER_EDF:  return "edf"; 
+    default:                          return "list"; 
+  }
+}
+
+static unsigned long option_value(int argc, char **argv, const char *option, unsigned long missing)
+{
+  int i; 
+  for (i = 1; i + 1 < argc; i++)
+  {
+    if (!strcmp(argv[i], option))
+      return strtoul(argv[i + 1], 0, 10); 
+  }
+  return missing; 
+}
+
+int main(int argc, char **argv)
+{
+  int json = host_has_flag(argc, argv, "--json"); 
+  unsigned long maxSkipped = option_value(argc, argv, "--max-skipped", ULONG_MAX); 
+  unsigned long maxMissed  = option_value(argc, argv, "--max-missed", ULONG_MAX); 
+  unsigned long maxLateP99 = option_value(argc, argv, "--max-late-p99", ULONG_MAX); 
+
+  unsigned int i, j; 
+  const char *path = 0; 
+  for (i = 1; i < (unsigned int)argc; i++)
+  {
+    // Skip the values of the limits.
+    if (!strncmp(argv[i], "--max", 5))
+      i++; 
+    else if (argv[i][0] != '-')
+      path = argv[i]; 
+  }
+
+  FILE *in = path ? fopen(path, "r") : stdin; 
+  if (!in)
+  {
+    perror(path); 
+    return 2; 
+  }
+
+  if (!read_workload(in))
+    return 2; 
+
+  timebase_use_virtual_clock(0); 
+
+  threadkernel_t *k = create_threadkernel_with_scheduler(&millis64, &micros64, 0, 0, scheduler); 
+  k->onIdle = host_virtual_idle; 
+
+  for (i = 0; i < groupCount; i++)
+  {
+    for (j = 0; j < groups[i].count; j++)
+    {
+      process_t *process = groups[i].immediate
+        ? k->addImmediateWithContext(k, run_group_process, &groups[i])
+        : k->addWithContext(k, run_group_process, &groups[i], groups[i].periodMilliseconds); 
+
+      if (!process)
+      {
+        fprintf(stderr, "process pool exhausted at %u processes\n", THREADKERNEL_MAX_PROCESSES); 
+        return 2; 
+      }
+
+      if (groups[i].deadlineMilliseconds)
+        k->setDeadline(k, process, groups[i].deadlineMilliseconds); 
+    }
+  }
+
+  uint64_t startNanos = host_nanos(); 
+  while(millis64() < durationMillis)
+  {
+    k->run(k); 
+    timebase_advance_virtual_clock(overheadMicros); 
+  }
+  uint64_t hostNanos = host_nanos() - startNanos; 
+
+  unsigned long runs = 0, skipped = 0, missed = 0, lateP99 = 0, lateMax = 0; 
+  process_t *process; 
+  for (process = k->firstProcess(k); process; process = k->nextProcess(k, process))
+  {
+    runs += process->totalExecutions; 
+    skipped += process->skippedExecutions; 
+    missed += process->deadlineMisses; 
+
+    if (process_histogram_p99(&process->latenessMilliseconds) > lateP99)
+      lateP99 = process_histogram_p99(&process->latenessMilliseconds); 
+    if (process_histogram_max(&process->latenessMilliseconds) > lateMax)
+      lateMax = process_histogram_max(&process->latenessMilliseconds); 
+  }
+
+  double seconds = millis64() / 1E3; 
+  double busyPercent = 100.0 * (micros64() - k->idleMicros) / micros64(); 
+  double nanosPerPass = k->totalExecutions ? (double)hostNanos / k->totalExecutions : 0; 
+
+  if (json)
+  {
+    printf("{\"scheduler\":\"%s\",\"simulatedMs\":%llu,\"passes\":%lu,\"runs\":%lu,"
+           "\"runsPerSecond\":%.1f,\"busyPercent\":%.2f,\"skipped\":%lu,\"missed\":%lu,"
+           "\"lateP99Ms\":%lu,\"lateMaxMs\":%lu,\"hostNanosPerPass\":%.1f}\n",
+      scheduler_name(), (unsigned long long)millis64(), k->totalExecutions, runs,
+      runs / seconds, busyPercent, skipped, missed, lateP99, lateMax, nanosPerPass); 
+  }
+  else
+  {
+    threadkernel_print_stats(k, stdout); 
+    printf("scheduler %s simulated %.1fs runs %lu (%.1f/s) busy %.1f%% skipped %lu missed %lu "
+           "late p99/max %lu/%lums host %.0fns/pass\n",
+      scheduler_name(), seconds, runs, runs / seconds, busyPercent, skipped, missed,
+      lateP99, lateMax, nanosPerPass); 
+  }
+
+  if (skipped > maxSkipped || missed > maxMissed || lateP99 > maxLateP99)
+  {
+    fprintf(stderr, "limits exceeded: skipped %lu/%lu missed %lu/%lu late p99 %lu/%lums\n",
+      skipped, maxSkipped, missed, maxMissed, lateP99, maxLateP99); 
+    return 1; 
+  }
+
+  return 0; 
+}
@@ -0,0 +1,193 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    Checks the budget policies on the virtual clock. REPORT only counts
+    overruns. BACKOFF doubles the period on each overrun, up to
+    THREADKERNEL_BUDGET_MAX_SHIFT times, halves it after each run within
+    budget, and is undone by setPeriod and setBudget. DEMOTE leaves the
+    period alone but, under THREADKERNEL_SCHEDULER_EDF, puts the process
+    behind another which falls due with it.
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#include "host.h"
+
+#define BUDGET_MICROS 100
+#define OVER_MICROS   200
+#define UNDER_MICROS  50
+#define ORDER_RUNS    64
+
+static unsigned long costMicros; 
+static uint64_t lastStartMillis; 
+
+static char order[ORDER_RUNS]; 
+static uint64_t orderMillis[ORDER_RUNS]; 
+static unsigned int orderCount; 
+
+static void task()
+{
+  lastStartMillis = millis64(); 
+  timebase_advance_virtual_clock(costMicros); 
+}
+
+static void record(void *context)
+{
+  if (orderCount < ORDER_RUNS)
+  {
+    order[orderCount] = *(const char *)context; 
+    orderMillis[orderCount++] = millis64(); 
+  }
+  timebase_advance_virtual_clock(*(const char *)context == 'A' ? OVER_MICROS : UNDER_MICROS); 
+}
+
+// Runs passes until the process has run once more, and returns when it started.
+static uint64_t run_once(threadkernel_t *k, process_t *process)
+{
+  unsigned long executions = process->totalExecutions; 
+  while(process->totalExecutions == executions)
+    k->run(k); 
+  return lastStartMillis; 
+}
+
+static void check_report(threadkernel_t *k)
+{
+  process_t *p = k->add(k, task, 10); 
+  CHECK(p); 
+  k->setBudget(k, p, BUDGET_MICROS, THREADKERNEL_BUDGET_REPORT); 
+
+  int i; 
+  costMicros = OVER_MICROS; 
+  for (i = 0; i < 5; i++)
+    run_once(k, p); 
+  costMicros = UNDER_MICROS; 
+  run_once(k, p); 
+
+  CHECK(p->budgetOverruns == 5); 
+  CHECK(p->periodMilliseconds == 10); 
+  CHECK(p->budgetShift == 0); 
+  CHECK(k->budgetOverruns == 5); 
+  CHECK(k->lastBudgetOverrunPid == p->pid); 
+
+  k->remove(k, p); 
+  k->run(k); 
+}
+
+static void check_backoff(threadkernel_t *k)
+{
+  process_t *p = k->add(k, task, 10); 
+  CHECK(p); 
+  k->setBudget(k, p, BUDGET_MICROS, THREADKERNEL_BUDGET_BACKOFF); 
+
+  // Each overrun doubles the period, up to 10 << THREADKERNEL_BUDGET_MAX_SHIFT,
+  // and the next run comes that much later.
+  unsigned long period = 10; 
+  int i; 
+  costMicros = OVER_MICROS; 
+  uint64_t start = run_once(k, p); 
+  for (i = 0; i < THREADKERNEL_BUDGET_MAX_SHIFT + 2; i++)
+  {
+    if (period < (10UL << THREADKERNEL_BUDGET_MAX_SHIFT))
+      period <<= 1; 
+    CHECK(p->periodMilliseconds == period); 
+
+    uint64_t next = run_once(k, p); 
+    CHECK(next - start >= period && next - start <= period + 1); 
+    start = next; 
+  }
+  CHECK(p->budgetShift == THREADKERNEL_BUDGET_MAX_SHIFT); 
+  CHECK(p->budgetOverruns == THREADKERNEL_BUDGET_MAX_SHIFT + 3); 
+
+  // Each run within budget halves it again, back to where it started.
+  costMicros = UNDER_MICROS; 
+  for (i = 0; i < THREADKERNEL_BUDGET_MAX_SHIFT; i++)
+  {
+    run_once(k, p); 
+    period >>= 1; 
+    CHECK(p->periodMilliseconds == period); 
+  }
+  run_once(k, p); 
+  CHECK(p->periodMilliseconds == 10 && p->budgetShift == 0); 
+
+  // setPeriod replaces the backoff.
+  costMicros = OVER_MICROS; 
+  run_once(k, p); 
+  run_once(k, p); 
+  CHECK(p->periodMilliseconds == 40); 
+  k->setPeriod(k, p, 15); 
+  CHECK(p->periodMilliseconds == 15 && p->budgetShift == 0); 
+
+  // setBudget undoes it.
+  run_once(k, p); 
+  CHECK(p->periodMilliseconds == 30); 
+  k->setBudget(k, p, BUDGET_MICROS, THREADKERNEL_BUDGET_REPORT); 
+  CHECK(p->periodMilliseconds == 15 && p->budgetShift == 0); 
+
+  k->remove(k, p); 
+  k->run(k); 
+}
+
+static void check_demote(threadkernel_t *k)
+{
+  static const char a = 'A', b = 'B'; 
+
+  // A is added first, so it runs first while the two are equal.
+  process_t *pa = k->addWithContext(k, record, (void *)&a, 10); 
+  process_t *pb = k->addWithContext(k, record, (void *)&b, 10); 
+  CHECK(pa && pb); 
+  k->setBudget(k, pa, BUDGET_MICROS, THREADKERNEL_BUDGET_DEMOTE); 
+
+  uint64_t end = millis64() + 10 * ORDER_RUNS; 
+  while(orderCount < ORDER_RUNS && millis64() < end)
+    k->run(k); 
+
+  CHECK(orderCount == ORDER_RUNS); 
+
+  // Both still run every 10ms, but once A has overrun, B goes first.
+  unsigned int i; 
+  CHECK(order[0] == 'A' && order[1] == 'B' && orderMillis[0] == orderMillis[1]); 
+  for (i = 2; i < ORDER_RUNS; i += 2)
+  {
+    CHECK(orderMillis[i] == orderMillis[i - 2] + 10); 
+    CHECK(order[i] == 'B' && order[i + 1] == 'A'); 
+  }
+
+  CHECK(pa->periodMilliseconds == 10); 
+  CHECK(pa->budgetShift == THREADKERNEL_BUDGET_MAX_SHIFT); 
+  CHECK(pa->budgetOverruns == pa->totalExecutions); 
+  CHECK(pb->budgetOverruns == 0); 
+  CHECK(k->lastBudgetOverrunPid == pa->pid); 
+}
+
+int main()
+{
+  timebase_use_virtual_clock(0); 
+
+  threadkernel_t *list = create_threadkernel(&millis64, &micros64, 0, 0); 
+  CHECK(list); 
+  list->onIdle = host_virtual_idle; 
+  check_report(list); 
+  check_backoff(list); 
+
+  // Start on a millisecond, so that both first runs fall in the same one.
+  timebase_use_virtual_clock(0); 
+  threadkernel_t *edf = create_threadkernel_with_scheduler(&millis64, &micros64, 0, 0, THREADKERNEL_SCHEDULER_EDF); 
+  CHECK(edf); 
+  edf->onIdle = host_virtual_idle; 
+  check_demote(edf); 
+
+  return 0; 
+}
@@ -0,0 +1,134 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    Checks coroutine processes and sleep() on the virtual clock: a sequence
+    which sleeps between steps beside a tight control loop under EDF, a
+    coroutine which yields every pass, and a periodic process whose sleep
+    moves its schedule.
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#include "host.h"
+
+#define STEPS 10
+#define STEP_SLEEP_MILLIS 500
+
+static threadkernel_t *k; 
+static uint64_t stepMillis[STEPS]; 
+static unsigned int steps, yields, controlRuns, sleeperRuns; 
+static uint64_t sleeperMillis[3]; 
+
+// Switches relays in turn, say, with a pause between each.
+static void sequence()
+{
+  static unsigned int i; 
+  CO_BEGIN(k); 
+  for (i = 0; i < STEPS; i++)
+  {
+    stepMillis[steps++] = millis64(); 
+    timebase_advance_virtual_clock(2000); 
+    CO_SLEEP(k, STEP_SLEEP_MILLIS); 
+  }
+  CO_END(k); 
+  k->wait(k); 
+}
+
+static void control()
+{
+  controlRuns++; 
+  timebase_advance_virtual_clock(100); 
+}
+
+static void yielder()
+{
+  static unsigned int i; 
+  CO_BEGIN(k); 
+  for (i = 0; i < 3; i++)
+  {
+    yields++; 
+    CO_YIELD(k); 
+  }
+  CO_END(k); 
+  k->wait(k); 
+}
+
+// Runs every 100ms, but sleeps for a second after its first run.
+static void sleeper()
+{
+  if (sleeperRuns < 3)
+    sleeperMillis[sleeperRuns] = millis64(); 
+  if (!sleeperRuns++)
+    k->sleep(k, 1000); 
+}
+
+int main()
+{
+  unsigned int i; 
+
+  timebase_use_virtual_clock(0); 
+  k = create_threadkernel_with_scheduler(&millis64, &micros64, 0, 0, THREADKERNEL_SCHEDULER_EDF); 
+  CHECK(k); 
+  k->onIdle = host_virtual_idle; 
+
+  CHECK(k->addImmediate(k, sequence)); 
+  process_t *c = k->add(k, control, 10); 
+  CHECK(c); 
+
+  while(millis64() < 8000)
+    k->run(k); 
+
+  printf("steps %u control runs %u missed %lu idle %.1f%%\n",
+    steps, controlRuns, c->deadlineMisses, 100.0 * k->idleMicros / micros64()); 
+
+  CHECK(steps == STEPS); 
+  for (i = 1; i < STEPS; i++)
+  {
+    CHECK(stepMillis[i] - stepMillis[i - 1] >= STEP_SLEEP_MILLIS); 
+    CHECK(stepMillis[i] - stepMillis[i - 1] <= STEP_SLEEP_MILLIS + 10); 
+  }
+  CHECK(c->deadlineMisses == 0); 
+  CHECK(controlRuns >= 790); 
+
+  // Sleeping, rather than spinning, leaves the kernel idle between control runs.
+  CHECK(k->idleMicros > micros64() / 2); 
+
+  // A yield resumes on the next pass.
+  process_t *y = k->addImmediate(k, yielder); 
+  CHECK(y); 
+  for (i = 0; i < 3; i++)
+  {
+    k->run(k); 
+    CHECK(yields == i + 1); 
+  }
+  k->run(k); 
+  CHECK(yields == 3 && y->waiting); 
+
+  // A periodic process's schedule carries on from the end of its sleep.
+  uint64_t startMillis = millis64(); 
+  CHECK(k->add(k, sleeper, 100)); 
+  while(millis64() < startMillis + 1500)
+    k->run(k); 
+
+  CHECK(sleeperRuns >= 3); 
+  CHECK(sleeperMillis[0] - startMillis <= 100 + 10); 
+  CHECK(sleeperMillis[1] - sleeperMillis[0] >= 1000); 
+  CHECK(sleeperMillis[1] - sleeperMillis[0] <= 1000 + 10); 
+  CHECK(sleeperMillis[2] - sleeperMillis[1] >= 100 - 10); 
+  CHECK(sleeperMillis[2] - sleeperMillis[1] <= 100 + 10); 
+
+  return 0; 
+}
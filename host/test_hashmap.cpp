@@ -0,0 +1,159 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    Runs random inserts, erases, finds and operator[] on an AOS::HashMap
+    beside a std::unordered_map and checks that they agree after every
+    operation. The values hold heap allocated strings, so entries which are
+    moved badly by Robin Hood displacement or backward shift erase show up
+    as damaged strings, or under the sanitizers. Copies, moves and the other
+    key types are checked after.
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#include <unordered_map>
+#include "host.h"
+#include <HashMap.h>
+
+#define OPERATIONS 2000000
+#define KEYS 5000
+
+struct Value
+{
+  std::string text; 
+  int number; 
+
+  Value() : number(-1) {}; 
+  Value(int number) : text(textFor(number)), number(number) {}; 
+
+  // Long enough not to fit in the small string buffer.
+  static std::string textFor(int number) { return std::to_string(number) + " degrees, more or less, give or take"; }; 
+  bool intact() const { return number == -1 ? text.empty() : text == textFor(number); }; 
+}; 
+
+enum class Mode : uint8_t { HEAT, COOL }; 
+
+static uint32_t seed = 1; 
+
+static uint32_t next_random()
+{
+  seed = seed * 1664525 + 1013904223; 
+  return seed >> 8; 
+}
+
+static void check_against(AOS::HashMap<uint32_t, Value>& map, std::unordered_map<uint32_t, int>& reference)
+{
+  size_t n = 0; 
+  for (auto& [key, value] : map)
+  {
+    auto it = reference.find(key); 
+    CHECK(it != reference.end() && it->second == value.number && value.intact()); 
+    n++; 
+  }
+  CHECK(n == reference.size() && map.size() == reference.size()); 
+}
+
+int main()
+{
+  AOS::HashMap<uint32_t, Value> map; 
+  std::unordered_map<uint32_t, int> reference; 
+
+  for (int i = 0; i < OPERATIONS; i++)
+  {
+    uint32_t key = next_random() % KEYS; 
+
+    switch (next_random() % 4)
+    {
+      case 0:
+        CHECK(map.insert(key, Value(i)) == reference.insert({key, i}).second); 
+        break; 
+
+      case 1:
+        CHECK(map.erase(key) == (reference.erase(key) == 1)); 
+        break; 
+
+      case 2:
+      {
+        Value* value = map.find(key); 
+        auto it = reference.find(key); 
+        CHECK((value != 0) == (it != reference.end())); 
+        if (value)
+          CHECK(value->number == it->second && value->intact()); 
+        break; 
+      }
+
+      default:
+        // Adds a default Value if absent.
+        CHECK(map[key].intact()); 
+        reference.insert({key, -1}); 
+        break; 
+    }
+
+    CHECK(map.size() == reference.size()); 
+
+    if (i % 500000 == 0)
+    {
+      // Copy, then assign the copy back over the original.
+      AOS::HashMap<uint32_t, Value> copy(map); 
+      check_against(copy, reference); 
+      map = copy; 
+      check_against(map, reference); 
+    }
+  }
+  check_against(map, reference); 
+
+  // A move leaves an empty map which can still be used.
+  AOS::HashMap<uint32_t, Value> moved(std::move(map)); 
+  check_against(moved, reference); 
+  CHECK(map.isEmpty()); 
+  map[1] = Value(1); 
+  CHECK(map.find(1)->intact()); 
+
+  moved.clear(); 
+  CHECK(moved.isEmpty() && moved.begin() == moved.end()); 
+
+  AOS::HashMap<std::string, int> names; 
+  names["living"] = 1; 
+  CHECK(names.insert("bedroom", 2)); 
+  CHECK(!names.insert("bedroom", 3)); 
+  CHECK(*names.find("bedroom") == 2 && names.count("living") && !names.count("office")); 
+
+  AOS::HashMap<std::array<uint8_t, 8>, int> addresses; 
+  addresses[{0x28, 0xFF, 0x12, 0x34, 0x56, 0x78, 0x04, 0x9A}] = 5; 
+  CHECK(addresses.count({0x28, 0xFF, 0x12, 0x34, 0x56, 0x78, 0x04, 0x9A})); 
+  CHECK(!addresses.count({0x28, 0xFF, 0x12, 0x34, 0x56, 0x78, 0x04, 0x9B})); 
+
+  // C string keys compare by content, not by pointer.
+  AOS::HashMap<const char*, int> strings; 
+  strings["office"] = 1; 
+  char office[] = "office"; 
+  CHECK(strings.count(office)); 
+
+  AOS::HashMap<Mode, int> modes; 
+  modes[Mode::COOL] = 3; 
+  CHECK(modes.count(Mode::COOL) && !modes.count(Mode::HEAT)); 
+
+  // Every key of a small type, then every other one erased.
+  AOS::HashMap<uint8_t, int> bytes; 
+  for (int i = 0; i < 256; i++)
+    bytes[i] = i; 
+  CHECK(bytes.size() == 256); 
+  for (int i = 0; i < 256; i += 2)
+    CHECK(bytes.erase(i)); 
+  CHECK(bytes.size() == 128 && *bytes.find(3) == 3 && !bytes.find(4)); 
+
+  return 0; 
+}
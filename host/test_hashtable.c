@@ -0,0 +1,107 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    Checks the chained and open addressing hashtable_t modes against each
+    other: adding, getting and removing integer keys and string keys longer
+    than the inline key storage, and how each treats a key added twice.
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#include "host.h"
+#include <hashtable.h>
+
+#define KEYS 20000
+
+static int keys[KEYS]; 
+static char names[KEYS][40]; 
+
+static void* item(int i) { return (void *)(intptr_t)(i + 1); }
+
+static void check_table(hashtable_t *h, const char *mode)
+{
+	int i; 
+
+	CHECK(h->is_empty(h)); 
+
+	for (i = 0; i < KEYS; i++)
+		h->add(h, &keys[i], sizeof(int), item(i)); 
+	CHECK(h->count == KEYS); 
+
+	for (i = 0; i < KEYS; i++)
+		CHECK(h->get(h, &keys[i], sizeof(int)) == item(i)); 
+
+	for (i = 0; i < KEYS; i += 2)
+		CHECK(h->remove(h, &keys[i], sizeof(int)) == item(i)); 
+	CHECK(h->count == KEYS / 2); 
+
+	for (i = 0; i < KEYS; i++)
+		CHECK(h->get(h, &keys[i], sizeof(int)) == (i % 2 ? item(i) : NULL)); 
+	CHECK(!h->remove(h, &keys[0], sizeof(int))); 
+
+	// Long keys are referenced rather than copied. 
+	for (i = 0; i < KEYS; i++)
+		h->add(h, names[i], strlen(names[i]), item(i)); 
+	for (i = 0; i < KEYS; i++)
+		CHECK(h->get(h, names[i], strlen(names[i])) == item(i)); 
+
+	// A key which is a prefix of another is a different key. 
+	CHECK(!h->get(h, names[0], strlen(names[0]) - 1)); 
+
+	for (i = 0; i < KEYS; i++)
+		CHECK(h->remove(h, names[i], strlen(names[i])) == item(i)); 
+	for (i = 1; i < KEYS; i += 2)
+		CHECK(h->remove(h, &keys[i], sizeof(int)) == item(i)); 
+
+	CHECK(h->count == 0); 
+	CHECK(h->is_empty(h)); 
+
+	printf("%s: ok, store %d\n", mode, h->store_size); 
+}
+
+int main()
+{
+	int i; 
+	for (i = 0; i < KEYS; i++)
+	{
+		keys[i] = i * 7919; 
+		snprintf(names[i], sizeof(names[i]), "thermostat/upstairs/bedroom-%d", i); 
+	}
+
+	hashtable_t *chained = create_hashtable(1024); 
+	check_table(chained, "chained"); 
+
+	hashtable_t *open = create_hashtable_open(4); 
+	check_table(open, "open"); 
+
+	// Adding a key twice: the open table replaces the item, the chained table 
+	// keeps both and finds the first. 
+	int key = 42; 
+	chained->add(chained, &key, sizeof(key), item(1)); 
+	chained->add(chained, &key, sizeof(key), item(2)); 
+	CHECK(chained->count == 2); 
+	CHECK(chained->get(chained, &key, sizeof(key)) == item(1)); 
+
+	open->add(open, &key, sizeof(key), item(1)); 
+	open->add(open, &key, sizeof(key), item(2)); 
+	CHECK(open->count == 1); 
+	CHECK(open->get(open, &key, sizeof(key)) == item(2)); 
+
+	chained->destroy(chained); 
+	open->destroy(open); 
+
+	return 0; 
+}
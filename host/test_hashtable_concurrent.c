@@ -0,0 +1,216 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    Checks hashtable_concurrent_t against a reference array on one thread,
+    including a full table, then stresses it: two writer threads, serialised
+    by lock hooks, put and remove values whose words all repeat one number,
+    while two reader threads get them. A reader which copies out a value with
+    two different words in it has seen a torn entry.
+
+    The values are 64KB so that copying one takes long enough to be
+    preempted part way, which lets the test catch a broken seqlock on a host
+    with a single CPU as well as on one where the threads run in parallel.
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#include <pthread.h>
+#include <sched.h>
+#include "host.h"
+#include <hashtable.h>
+
+#define CAPACITY 64
+#define KEYS 48
+#define REFERENCE_KEYS 60
+#define REFERENCE_OPERATIONS 200000
+#define STRESS_MILLIS 3000
+#define WORDS 16384
+
+typedef struct
+{
+	uint32_t words[WORDS]; 
+} value_t; 
+
+static hashtable_concurrent_t *h; 
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER; 
+static volatile int writing = 1; 
+
+typedef struct
+{
+	long hits; 
+	long torn; 
+	long wrong; 
+} reader_t; 
+
+static void lock() { pthread_mutex_lock(&mutex); }
+static void unlock() { pthread_mutex_unlock(&mutex); }
+
+static uint32_t next_random(uint32_t *seed)
+{
+	*seed = *seed * 1664525 + 1013904223;
+	return *seed >> 8; 
+}
+
+// Every word holds the write number above the key.
+static void make_value(value_t *value, uint32_t n, uint32_t key)
+{
+	int i; 
+	for (i = 0; i < WORDS; i++)
+		value->words[i] = (n << 8) | key; 
+}
+
+static void check_reference()
+{
+	int reference[REFERENCE_KEYS] = { 0 }; 
+	int count = 0, n; 
+	uint32_t seed = 2; 
+	value_t value; 
+
+	for (n = 0; n < REFERENCE_OPERATIONS; n++)
+	{
+		uint32_t key = next_random(&seed) % REFERENCE_KEYS; 
+
+		switch (next_random(&seed) % 3)
+		{
+			case 0:
+				make_value(&value, n, key); 
+				if (h->put(h, &key, sizeof(key), &value))
+				{
+					count += !reference[key]; 
+					reference[key] = n + 1; 
+				}
+				else
+				{
+					// Only a new key is refused, and only when 7/8 of the slots are taken.
+					CHECK(!reference[key] && (count + 1) * 8 > CAPACITY * 7); 
+				}
+				break; 
+
+			case 1:
+				CHECK(h->remove(h, &key, sizeof(key)) == (reference[key] != 0)); 
+				count -= reference[key] != 0; 
+				reference[key] = 0; 
+				break; 
+
+			default:
+				CHECK(h->get(h, &key, sizeof(key), &value) == (reference[key] != 0)); 
+				if (reference[key])
+					CHECK(value.words[WORDS - 1] == (((uint32_t)(reference[key] - 1) << 8) | key)); 
+				break; 
+		}
+
+		CHECK(h->count == count); 
+	}
+
+	for (n = 0; n < REFERENCE_KEYS; n++)
+		h->remove(h, &n, sizeof(n)); 
+	CHECK(h->count == 0); 
+}
+
+// Each writer owns the keys of its own parity, so their values never mix.
+static void* write_values(void *argument)
+{
+	uint32_t parity = (uint32_t)(intptr_t)argument; 
+	uint32_t seed = 3 + parity, n; 
+	uint64_t end = host_millis() + STRESS_MILLIS; 
+	value_t value; 
+
+	for (n = 0; host_millis() < end; n++)
+	{
+		uint32_t key = (next_random(&seed) % (KEYS / 2)) * 2 + parity; 
+
+		if (next_random(&seed) % 4)
+		{
+			make_value(&value, n, key); 
+			CHECK(h->put(h, &key, sizeof(key), &value)); 
+		}
+		else
+		{
+			h->remove(h, &key, sizeof(key)); 
+		}
+	}
+
+	return 0; 
+}
+
+static void* read_values(void *argument)
+{
+	reader_t *reader = (reader_t *)argument; 
+	value_t value; 
+	uint32_t key; 
+	int i; 
+
+	while (writing)
+	{
+		for (key = 0; key < KEYS; key++)
+		{
+			if (!h->get(h, &key, sizeof(key), &value))
+				continue; 
+
+			reader->hits++; 
+			for (i = 1; i < WORDS; i++)
+			{
+				if (value.words[i] != value.words[0])
+				{
+					reader->torn++; 
+					break; 
+				}
+			}
+			if ((value.words[0] & 0xFF) != key)
+				reader->wrong++; 
+		}
+	}
+
+	return 0; 
+}
+
+int main()
+{
+	pthread_t writers[2], readers[2]; 
+	reader_t reader[2]; 
+	int i; 
+
+	h = create_hashtable_concurrent(CAPACITY, sizeof(value_t)); 
+	hashtable_concurrent_set_lock(h, lock, unlock); 
+	CHECK(h->capacity == CAPACITY); 
+
+	check_reference(); 
+
+	memset(reader, 0, sizeof(reader)); 
+	for (i = 0; i < 2; i++)
+		pthread_create(&readers[i], 0, read_values, &reader[i]); 
+	for (i = 0; i < 2; i++)
+		pthread_create(&writers[i], 0, write_values, (void *)(intptr_t)i); 
+
+	for (i = 0; i < 2; i++)
+		pthread_join(writers[i], 0); 
+	writing = 0; 
+	for (i = 0; i < 2; i++)
+		pthread_join(readers[i], 0); 
+
+	for (i = 0; i < 2; i++)
+	{
+		printf("reader %d: hits %ld torn %ld wrong %ld\n", i, reader[i].hits, reader[i].torn, reader[i].wrong); 
+		CHECK(reader[i].torn == 0 && reader[i].wrong == 0); 
+		CHECK(reader[i].hits > 0); 
+	}
+
+	// No write was left open.
+	CHECK(h->sequence % 2 == 0); 
+
+	h->destroy(h); 
+	return 0; 
+}
@@ -0,0 +1,115 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    Runs random adds, gets and removes against both hashtable_t modes and a
+    plain array of what should be present, so that every operation is
+    checked while the tables grow and move entries across between stores.
+    The keys first range widely, so the tables grow, then the operations
+    churn a few keys among the rest. Finally every key is removed, and the
+    chained table must shrink back to its first size.
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#include "host.h"
+#include <hashtable.h>
+
+#define KEYS 50000
+#define OPERATIONS 2000000L
+
+static uint32_t keys[KEYS]; 
+static unsigned char present[KEYS]; 
+
+static void* item(int k) { return (void *)(intptr_t)(k + 1); }
+
+static void check_table(hashtable_t *h, int open, const char *mode)
+{
+	long op; 
+	int k, count = 0, largest = 0; 
+
+	memset(present, 0, sizeof(present)); 
+	srand(2); 
+
+	for (op = 0; op < OPERATIONS; op++)
+	{
+		k = rand() % (op < OPERATIONS / 2 ? KEYS : KEYS / 50); 
+
+		switch (rand() % 3)
+		{
+			case 0:
+				// The chained table would chain a second entry, so only add absent keys to it.
+				if (!present[k] || open)
+				{
+					if (!present[k])
+						count++; 
+					h->add(h, &keys[k], sizeof(uint32_t), item(k)); 
+					present[k] = 1; 
+				}
+				break; 
+			case 1:
+				CHECK(h->remove(h, &keys[k], sizeof(uint32_t)) == (present[k] ? item(k) : NULL)); 
+				if (present[k])
+					count--; 
+				present[k] = 0; 
+				break; 
+			default:
+				CHECK(h->get(h, &keys[k], sizeof(uint32_t)) == (present[k] ? item(k) : NULL)); 
+		}
+
+		CHECK(h->count == count); 
+		if (h->store_size > largest)
+			largest = h->store_size; 
+	}
+
+	for (k = 0; k < KEYS; k++)
+	{
+		if (present[k])
+			CHECK(h->remove(h, &keys[k], sizeof(uint32_t)) == item(k)); 
+	}
+	CHECK(h->count == 0); 
+
+	// Shrinking is spread over later operations too.
+	for (k = 0; k < 10000; k++)
+		CHECK(!h->get(h, &keys[0], sizeof(uint32_t))); 
+
+	printf("%s: largest store %d, %d when empty\n", mode, largest, h->store_size); 
+
+	// About half the keys are present at once.
+	CHECK(largest >= KEYS / 4); 
+	if (!open)
+	{
+		CHECK(h->store_size == 8); 
+		CHECK(!h->old_store); 
+	}
+	else
+	{
+		CHECK(!h->old_entries); 
+	}
+
+	h->destroy(h); 
+}
+
+int main()
+{
+	int k; 
+	for (k = 0; k < KEYS; k++)
+		keys[k] = k * 2654435761u; 
+
+	check_table(create_hashtable(8), 0, "chained"); 
+	check_table(create_hashtable_open(8), 1, "open"); 
+
+	return 0; 
+}
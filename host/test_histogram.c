@@ -0,0 +1,99 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    Checks the execution time histogram with known samples: an immediate
+    process on the virtual clock takes exactly as long as it is told to. A
+    percentile is the upper bound of the power of two bucket it falls in,
+    but never more than the largest sample. When a bucket fills, every
+    bucket is halved, but the maximum is kept.
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#include "host.h"
+
+static unsigned long costMicros; 
+
+static void task() { timebase_advance_virtual_clock(costMicros); }
+
+static void run_samples(threadkernel_t *k, process_t *p, unsigned long micros, unsigned long n)
+{
+  unsigned long i; 
+  costMicros = micros; 
+  for (i = 0; i < n; i++)
+    k->run(k); 
+}
+
+int main()
+{
+  timebase_use_virtual_clock(0); 
+  threadkernel_t *k = create_threadkernel(&millis64, &micros64, 0, 0); 
+  CHECK(k); 
+
+  process_t *p = k->addImmediate(k, task); 
+  CHECK(p); 
+  process_histogram_t *h = &p->executionMicros; 
+
+  CHECK(process_histogram_p50(h) == 0); 
+  CHECK(process_histogram_p99(h) == 0); 
+  CHECK(process_histogram_max(h) == 0); 
+
+  // 90 samples of 5us fall in [4, 7], 9 of 100us in [64, 127], and one of 1000us
+  // in [512, 1023].
+  run_samples(k, p, 5, 90); 
+  run_samples(k, p, 100, 9); 
+  run_samples(k, p, 1000, 1); 
+  CHECK(h->count == 100); 
+  CHECK(h->buckets[3] == 90 && h->buckets[7] == 9 && h->buckets[10] == 1); 
+
+  CHECK(process_histogram_p50(h) == 7); 
+  CHECK(process_histogram_percentile(h, 90) == 7); 
+  CHECK(process_histogram_percentile(h, 91) == 127); 
+  CHECK(process_histogram_p99(h) == 127); 
+  CHECK(process_histogram_percentile(h, 100) == 1000); 
+  CHECK(process_histogram_percentile(h, 1000) == 1000); 
+  CHECK(process_histogram_max(h) == 1000); 
+
+  // Zero takes a bucket of its own.
+  run_samples(k, p, 0, 1); 
+  CHECK(h->buckets[0] == 1); 
+  CHECK(process_histogram_percentile(h, 0) == 0); 
+
+  // Samples beyond the top bucket go in it, and it reports the maximum.
+  run_samples(k, p, 1UL << 28, 1); 
+  CHECK(h->buckets[THREADKERNEL_HISTOGRAM_BUCKETS - 1] == 1); 
+  CHECK(process_histogram_percentile(h, 100) == 1UL << 28); 
+  CHECK(process_histogram_max(h) == 1UL << 28); 
+
+  // Fill the 5us bucket. The next sample in it halves every bucket first.
+  run_samples(k, p, 5, UINT16_MAX - 90); 
+  CHECK(h->buckets[3] == UINT16_MAX); 
+  CHECK(h->count == UINT16_MAX + 9 + 1 + 1 + 1); 
+
+  run_samples(k, p, 5, 1); 
+  CHECK(h->buckets[3] == UINT16_MAX / 2 + 1); 
+  CHECK(h->buckets[7] == 4); 
+  CHECK(h->buckets[10] == 0 && h->buckets[0] == 0); 
+  CHECK(h->buckets[THREADKERNEL_HISTOGRAM_BUCKETS - 1] == 0); 
+  CHECK(h->count == UINT16_MAX / 2 + 1 + 4); 
+
+  // The samples of 1000us and more are forgotten, but the maximum is not.
+  CHECK(process_histogram_p50(h) == 7); 
+  CHECK(process_histogram_percentile(h, 100) == 127); 
+  CHECK(process_histogram_max(h) == 1UL << 28); 
+
+  return 0; 
+}
@@ -0,0 +1,84 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    Checks the load averages on the virtual clock. A process busy for 3ms of
+    every 10ms should bring the 1s, 10s and 60s averages of both it and its
+    kernel to 30%. Once it stops, each average should decay by 1/e over its
+    own time constant, including across a gap between passes far longer
+    than a sample.
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#include <math.h>
+#include "host.h"
+
+static unsigned long costMicros = 3000; 
+
+static void task() { timebase_advance_virtual_clock(costMicros); }
+
+static void run_for(threadkernel_t *k, uint64_t milliseconds)
+{
+  uint64_t end = millis64() + milliseconds; 
+  while(millis64() < end)
+    k->run(k); 
+}
+
+static void check_near(const char *what, const uint32_t load[THREADKERNEL_LOAD_AVERAGES], unsigned int average, double expected, double tolerance)
+{
+  double percent = threadkernel_load_percent(load, average); 
+  printf("%-10s %s average %6.2f%%, expected %6.2f%%\n", what,
+    average == THREADKERNEL_LOAD_1S ? " 1s" : average == THREADKERNEL_LOAD_10S ? "10s" : "60s", percent, expected); 
+  CHECK(fabs(percent - expected) <= tolerance); 
+}
+
+int main()
+{
+  timebase_use_virtual_clock(0); 
+  threadkernel_t *k = create_threadkernel(&millis64, &micros64, 0, 0); 
+  CHECK(k); 
+  k->onIdle = host_virtual_idle; 
+
+  process_t *p = k->add(k, task, 10); 
+  CHECK(p); 
+
+  // Ten minutes is ten time constants of the slowest average.
+  run_for(k, 600000); 
+
+  unsigned int i; 
+  for (i = 0; i < THREADKERNEL_LOAD_AVERAGES; i++)
+  {
+    check_near("kernel", k->load, i, 30, 1); 
+    check_near("process", p->load, i, 30, 1); 
+  }
+
+  // After 10s of nothing, each average has decayed by e^(-10s / tau).
+  costMicros = 0; 
+  run_for(k, 10000); 
+  check_near("kernel", k->load, THREADKERNEL_LOAD_1S, 0, 0.5); 
+  check_near("kernel", k->load, THREADKERNEL_LOAD_10S, 30 * exp(-1), 1.5); 
+  check_near("kernel", k->load, THREADKERNEL_LOAD_60S, 30 * exp(-10.0 / 60), 1.5); 
+
+  // A single gap of 50s between passes is caught up in one go.
+  k->remove(k, p); 
+  k->run(k); 
+  timebase_advance_virtual_clock(50000000); 
+  k->run(k); 
+  check_near("kernel", k->load, THREADKERNEL_LOAD_60S, 30 * exp(-1), 1.5); 
+  check_near("kernel", k->load, THREADKERNEL_LOAD_10S, 0, 0.5); 
+
+  return 0; 
+}
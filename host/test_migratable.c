@@ -0,0 +1,178 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    Checks migratable processes. On the virtual clock: they run on whichever
+    kernel is free, and are not starved when both kernels always have an
+    immediate process ready. On the real clock, with each kernel on its own
+    thread: work moves off a saturated kernel onto an idle one, every run is
+    counted once, and more jobs get done than when they are pinned to the
+    saturated kernel.
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#include <pthread.h>
+#include "host.h"
+
+#define JOBS 8
+#define JOB_PERIOD 4
+
+static pthread_mutex_t sharedMutex = PTHREAD_MUTEX_INITIALIZER; 
+static void lock() { pthread_mutex_lock(&sharedMutex); }
+static void unlock() { pthread_mutex_unlock(&sharedMutex); }
+
+static volatile unsigned long jobRuns; 
+
+static void busy() { timebase_advance_virtual_clock(100); }
+static void job() { jobRuns++; timebase_advance_virtual_clock(50); }
+
+static void busy_real() { host_spin_micros(900); }
+static void job_real() { host_spin_micros(100); __sync_fetch_and_add(&jobRuns, 1); }
+
+static void sleep_idle(threadkernel_t *k, uint64_t milliseconds)
+{
+  (void)k; 
+  struct timespec t = { 0, (long)(milliseconds > 1 ? 1 : milliseconds) * 1000000L }; 
+  nanosleep(&t, 0); 
+}
+
+static volatile int stop; 
+
+static void* run_kernel(void *argument)
+{
+  threadkernel_t *k = (threadkernel_t *)argument; 
+  while(!stop)
+    k->run(k); 
+  return 0; 
+}
+
+// Runs each kernel on a thread of its own for two seconds, and returns the
+// jobs done.
+static unsigned long run_threads(threadkernel_t *k0, threadkernel_t *k1)
+{
+  pthread_t t0, t1; 
+  struct timespec t = { 2, 0 }; 
+
+  jobRuns = 0; 
+  stop = 0; 
+  pthread_create(&t0, 0, run_kernel, k0); 
+  pthread_create(&t1, 0, run_kernel, k1); 
+  nanosleep(&t, 0); 
+  stop = 1; 
+  pthread_join(t0, 0); 
+  pthread_join(t1, 0); 
+
+  return jobRuns; 
+}
+
+int main()
+{
+  unsigned int i; 
+  process_t *jobs[JOBS]; 
+
+  // Virtual clock, with both kernels taking turns on this thread.
+  timebase_use_virtual_clock(0); 
+  threadkernel_t *k0 = create_threadkernel(&millis64, &micros64, 0, 0); 
+  threadkernel_t *k1 = create_threadkernel(&millis64, &micros64, 0, 0); 
+  CHECK(k0 && k1); 
+
+  // One job every 10ms, with k1 idle: it should take all of them, to time.
+  process_t *process = k0->addMigratable(k0, job, 10); 
+  CHECK(process); 
+  CHECK(k0->addImmediate(k0, busy)); 
+  while(millis64() < 6000)
+  {
+    k0->run(k0); 
+    k1->run(k1); 
+    timebase_advance_virtual_clock(100); 
+  }
+  printf("one busy kernel: runs %lu k0 %lu k1 %lu skipped %lu\n",
+    jobRuns, k0->migratableRuns, k1->migratableRuns, process->skippedExecutions); 
+  CHECK(jobRuns >= 590); 
+  CHECK(k0->migratableRuns == 0); 
+  CHECK(process->skippedExecutions == 0); 
+
+  // Now both kernels always have an immediate process ready. The job still
+  // runs, once it is a period overdue.
+  CHECK(k1->addImmediate(k1, busy)); 
+  jobRuns = 0; 
+  uint64_t startMillis = millis64(); 
+  while(millis64() < startMillis + 6000)
+  {
+    k0->run(k0); 
+    k1->run(k1); 
+  }
+  printf("both kernels busy: runs %lu late p99 %lums\n",
+    jobRuns, process_histogram_p99(&process->latenessMilliseconds)); 
+  CHECK(jobRuns >= 6000 / 20 - 1); 
+  CHECK(process_histogram_max(&process->latenessMilliseconds) <= 2 * 10); 
+
+  // Real clock, a kernel a thread. The saturated kernel always has an
+  // immediate process ready, the idle one has nothing of its own. First the
+  // jobs are pinned to the saturated kernel, which cannot keep up with them.
+  k0->remove(k0, process); 
+  k0->run(k0); 
+
+  threadkernel_set_lock(lock, unlock); 
+  threadkernel_t *pinned = create_threadkernel(&host_millis, &host_micros, 0, 0); 
+  threadkernel_t *saturated = create_threadkernel(&host_millis, &host_micros, 0, 0); 
+  threadkernel_t *idle = create_threadkernel(&host_millis, &host_micros, 0, 0); 
+  CHECK(pinned && saturated && idle); 
+  pinned->onIdle = saturated->onIdle = idle->onIdle = sleep_idle; 
+  CHECK(pinned->addImmediate(pinned, busy_real)); 
+  CHECK(saturated->addImmediate(saturated, busy_real)); 
+
+  for (i = 0; i < JOBS; i++)
+    CHECK(pinned->add(pinned, job_real, JOB_PERIOD)); 
+  unsigned long pinnedRuns = run_threads(pinned, idle); 
+
+  // Then the same jobs as migratable processes: the idle kernel should do
+  // almost all of them, and more get done.
+  for (i = 0; i < JOBS; i++)
+  {
+    jobs[i] = saturated->addMigratable(saturated, job_real, JOB_PERIOD); 
+    CHECK(jobs[i]); 
+  }
+  unsigned long migratableRuns = run_threads(saturated, idle); 
+
+  unsigned long executions = 0, migrations = 0; 
+  for (i = 0; i < JOBS; i++)
+  {
+    executions += jobs[i]->totalExecutions; 
+    migrations += jobs[i]->migrations; 
+  }
+
+  printf("two threads: pinned jobs %lu, migratable jobs %lu on saturated %lu on idle %lu migrations %lu\n",
+    pinnedRuns, migratableRuns, saturated->migratableRuns, idle->migratableRuns, migrations); 
+
+  // Eight jobs every 4ms for 2s is 4000 runs. Pinned, each one waits behind
+  // a run of the busy process, so at most half of them fit.
+  CHECK(migratableRuns == executions); 
+  CHECK(migratableRuns == saturated->migratableRuns + idle->migratableRuns); 
+  CHECK(idle->migratableRuns > 4 * saturated->migratableRuns); 
+  CHECK(migratableRuns > pinnedRuns * 3 / 2); 
+
+  // A full migratable table refuses more, and hands back the process slot.
+  while(k0->addMigratable(k0, job, 1000)); 
+  unsigned int available = threadkernel_processes_available(); 
+  unsigned long failures = threadkernel_process_allocation_failures(); 
+  CHECK(available > 0); 
+  CHECK(!k0->addMigratable(k0, job, 1000)); 
+  CHECK(threadkernel_processes_available() == available); 
+  CHECK(threadkernel_process_allocation_failures() == failures + 1); 
+
+  return 0; 
+}
@@ -0,0 +1,125 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    Checks the process pool: adds fail cleanly when it is exhausted, removed
+    slots and their pids are reused, and two kernels on their own threads can
+    add and remove processes at the same time without a slot being handed out
+    twice or lost.
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#include <pthread.h>
+#include "host.h"
+
+#define CHURN_ROUNDS 200000
+#define CHURN_BATCH  8
+
+static pthread_mutex_t sharedMutex = PTHREAD_MUTEX_INITIALIZER; 
+static void lock() { pthread_mutex_lock(&sharedMutex); }
+static void unlock() { pthread_mutex_unlock(&sharedMutex); }
+
+static void nop() { }
+
+// The kernel which holds each pid, to catch a slot given to both threads.
+static threadkernel_t* volatile owners[THREADKERNEL_MAX_PROCESSES + 1]; 
+static volatile int duplicates = 0; 
+
+static void* churn(void *argument)
+{
+  threadkernel_t *k = (threadkernel_t *)argument; 
+  process_t *processes[CHURN_BATCH]; 
+  unsigned int round, i; 
+
+  for (round = 0; round < CHURN_ROUNDS; round++)
+  {
+    for (i = 0; i < CHURN_BATCH; i++)
+    {
+      processes[i] = i % 2 ? k->add(k, nop, 1000) : k->addImmediate(k, nop); 
+      if (processes[i] && !__sync_bool_compare_and_swap(&owners[processes[i]->pid], 0, k))
+        duplicates++; 
+    }
+
+    for (i = 0; i < CHURN_BATCH; i++)
+    {
+      if (!processes[i])
+        continue; 
+      owners[processes[i]->pid] = 0; 
+      k->remove(k, processes[i]); 
+    }
+
+    // Removed processes go back to the pool at the end of the pass.
+    k->run(k); 
+  }
+
+  return 0; 
+}
+
+int main()
+{
+  unsigned int i; 
+  process_t *processes[THREADKERNEL_MAX_PROCESSES + 6]; 
+
+  timebase_use_virtual_clock(0); 
+  threadkernel_t *k = create_threadkernel_with_scheduler(&millis64, &micros64, 0, 0, THREADKERNEL_SCHEDULER_HEAP); 
+  CHECK(k); 
+
+  // Exhaustion.
+  for (i = 0; i < THREADKERNEL_MAX_PROCESSES + 6; i++)
+    processes[i] = k->add(k, nop, 1000); 
+  for (i = 0; i < THREADKERNEL_MAX_PROCESSES; i++)
+    CHECK(processes[i] && processes[i]->pid == i + 1); 
+  for (; i < THREADKERNEL_MAX_PROCESSES + 6; i++)
+    CHECK(!processes[i]); 
+  CHECK(threadkernel_processes_available() == 0); 
+  CHECK(threadkernel_process_allocation_failures() == 6); 
+
+  // Reuse.
+  unsigned int pid = processes[3]->pid; 
+  k->remove(k, processes[3]); 
+  CHECK(threadkernel_processes_available() == 0); 
+  k->run(k); 
+  CHECK(threadkernel_processes_available() == 1); 
+  CHECK(!k->getProcessByPid(k, pid)); 
+
+  processes[3] = k->add(k, nop, 1000); 
+  CHECK(processes[3] && processes[3]->pid == pid); 
+  CHECK(k->getProcessByPid(k, pid) == processes[3]); 
+
+  for (i = 0; i < THREADKERNEL_MAX_PROCESSES; i++)
+    k->remove(k, processes[i]); 
+  k->run(k); 
+  CHECK(threadkernel_processes_available() == THREADKERNEL_MAX_PROCESSES); 
+
+  // Both kernels adding and removing at once.
+  threadkernel_set_lock(lock, unlock); 
+  threadkernel_t *k0 = create_threadkernel(&millis64, &micros64, 0, 0); 
+  threadkernel_t *k1 = create_threadkernel(&millis64, &micros64, 0, 0); 
+  CHECK(k0 && k1); 
+
+  pthread_t t0, t1; 
+  pthread_create(&t0, 0, churn, k0); 
+  pthread_create(&t1, 0, churn, k1); 
+  pthread_join(t0, 0); 
+  pthread_join(t1, 0); 
+
+  printf("churn: duplicates %d available %u of %u\n", duplicates, threadkernel_processes_available(), THREADKERNEL_MAX_PROCESSES); 
+  CHECK(duplicates == 0); 
+  CHECK(threadkernel_processes_available() == THREADKERNEL_MAX_PROCESSES); 
+  CHECK(!k0->firstProcess(k0) && !k1->firstProcess(k1)); 
+
+  return 0; 
+}
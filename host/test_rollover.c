@@ -0,0 +1,74 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    Drives a kernel straight through the point where a 32 bit millis() clock
+    would roll over, about 49.7 days after boot, and checks that periodic
+    processes and timers carry on to time.
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#include "host.h"
+
+#define ROLLOVER_MILLIS (1ULL << 32)
+
+static unsigned long fastRuns, slowRuns, timerRuns; 
+static uint64_t timerFiredAt; 
+
+static void fast() { fastRuns++; }
+static void slow() { slowRuns++; }
+
+static void timer(void *context)
+{
+  (void)context; 
+  timerRuns++; 
+  timerFiredAt = millis64(); 
+}
+
+int main()
+{
+  // Ten seconds before the 32 bit wrap.
+  timebase_use_virtual_clock((ROLLOVER_MILLIS - 10000) * 1000); 
+
+  threadkernel_t *k = create_threadkernel_with_scheduler(&millis64, &micros64, 0, 0, THREADKERNEL_SCHEDULER_HEAP); 
+  CHECK(k); 
+  process_t *f = k->add(k, fast, 10); 
+  process_t *s = k->add(k, slow, 1000); 
+  CHECK(f && s); 
+  CHECK(k->after(k, 15000, timer, 0)); 
+
+  // Twenty seconds, one pass a millisecond.
+  while(millis64() < ROLLOVER_MILLIS + 10000)
+  {
+    k->run(k); 
+    timebase_advance_virtual_clock(1000); 
+  }
+
+  printf("fast %lu slow %lu timer %lu at %+lld ms\n", fastRuns, slowRuns, timerRuns,
+    (long long)(timerFiredAt - ROLLOVER_MILLIS)); 
+
+  CHECK(fastRuns == 2000 - 1); 
+  CHECK(slowRuns == 20 - 1); 
+  CHECK(f->skippedExecutions == 0 && s->skippedExecutions == 0); 
+  CHECK(process_histogram_max(&f->latenessMilliseconds) == 0); 
+  CHECK(process_histogram_max(&s->latenessMilliseconds) == 0); 
+  CHECK(f->nextRunMilliseconds > ROLLOVER_MILLIS); 
+
+  CHECK(timerRuns == 1); 
+  CHECK(timerFiredAt == ROLLOVER_MILLIS + 5000); 
+
+  return 0; 
+}
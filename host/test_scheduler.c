@@ -0,0 +1,151 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    Checks that every scheduler runs the same periodic processes the same
+    number of times, and that the heap schedulers only run immediate
+    processes once a pass when nothing is due. Then checks that a pass stops
+    when a process empties the heap, rather than running a stale entry, and
+    that a process suspended and resumed within a pass runs only once in it.
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#include "host.h"
+
+static unsigned long fastRuns, slowRuns, immediateRuns; 
+
+static void fast() { fastRuns++; timebase_advance_virtual_clock(10); }
+static void slow() { slowRuns++; }
+static void immediate() { immediateRuns++; }
+
+static void check_scheduler(threadkernel_scheduler_t scheduler)
+{
+  fastRuns = slowRuns = immediateRuns = 0; 
+  timebase_use_virtual_clock(0); 
+
+  threadkernel_t *k = create_threadkernel_with_scheduler(&millis64, &micros64, 0, 0, scheduler); 
+  CHECK(k); 
+  CHECK(k->add(k, fast, 10)); 
+  CHECK(k->add(k, slow, 25)); 
+  CHECK(k->addImmediate(k, immediate)); 
+
+  // One pass a millisecond for a second. Processes first fall due a period
+  // after they are added.
+  unsigned long passes = 0; 
+  while(millis64() < 1000)
+  {
+    k->run(k); 
+    passes++; 
+    timebase_advance_virtual_clock(1000 - micros64() % 1000); 
+  }
+
+  printf("scheduler %d: fast %lu slow %lu immediate %lu passes %lu skipped %lu\n",
+    scheduler, fastRuns, slowRuns, immediateRuns, passes, k->processes->skippedExecutions); 
+
+  CHECK(passes == 1000); 
+  CHECK(fastRuns == 99); 
+  CHECK(slowRuns == 39); 
+
+  // The list scheduler runs the immediate processes after every periodic
+  // process, whether or not it was due. The others run them after each one
+  // that ran, or once if none did. Something is due on 119 of the passes.
+  // EDF runs them once a pass whatever was due.
+  if (scheduler == THREADKERNEL_SCHEDULER_LIST)
+    CHECK(immediateRuns == 2 * passes); 
+  else if (scheduler == THREADKERNEL_SCHEDULER_HEAP)
+    CHECK(immediateRuns == passes - 119 + fastRuns + slowRuns); 
+  else
+    CHECK(immediateRuns == passes); 
+}
+
+static threadkernel_t *emptied; 
+static process_t *last; 
+static unsigned long firstRuns, lastRuns; 
+
+// Empties the heap from its top, leaving the other process there though it
+// has left the heap, still due, with the pass expecting to visit it.
+static void first()
+{
+  firstRuns++; 
+  emptied->remove(emptied, emptied->current); 
+  emptied->suspend(emptied, last); 
+}
+static void second() { lastRuns++; }
+
+static void check_emptied(threadkernel_scheduler_t scheduler)
+{
+  firstRuns = lastRuns = immediateRuns = 0; 
+  timebase_use_virtual_clock(0); 
+
+  emptied = create_threadkernel_with_scheduler(&millis64, &micros64, 0, 0, scheduler); 
+  CHECK(emptied); 
+  CHECK(emptied->add(emptied, first, 10)); 
+  CHECK(last = emptied->add(emptied, second, 10)); 
+  CHECK(emptied->addImmediate(emptied, immediate)); 
+
+  // The pass ends once the heap is empty, so the immediate processes run once
+  // after the one process which ran.
+  timebase_advance_virtual_clock(10000); 
+  emptied->run(emptied); 
+  CHECK(firstRuns == 1 && lastRuns == 0); 
+  CHECK(immediateRuns == 1); 
+}
+
+static threadkernel_t *resumer; 
+static process_t *resumed; 
+static unsigned long resumerRuns, resumedRuns; 
+
+// Runs ahead of the other, which is due too, suspends and resumes it, then
+// overruns the other's new period, so that it is due again within the pass.
+static void resume_other()
+{
+  resumerRuns++; 
+  resumer->suspend(resumer, resumed); 
+  resumer->resume(resumer, resumed); 
+  timebase_advance_virtual_clock(20000); 
+}
+static void count_resumed() { resumedRuns++; }
+
+static void check_resumed(threadkernel_scheduler_t scheduler)
+{
+  resumerRuns = resumedRuns = 0; 
+  timebase_use_virtual_clock(0); 
+
+  resumer = create_threadkernel_with_scheduler(&millis64, &micros64, 0, 0, scheduler); 
+  CHECK(resumer); 
+  CHECK(resumer->add(resumer, resume_other, 5)); 
+  CHECK(resumed = resumer->add(resumer, count_resumed, 10)); 
+  // Not due, but lets the pass visit three processes.
+  CHECK(resumer->add(resumer, slow, 1000000)); 
+
+  // The resumed process runs once in the pass, after the other.
+  timebase_advance_virtual_clock(10000); 
+  resumer->run(resumer); 
+  CHECK(resumerRuns == 1 && resumedRuns == 1); 
+  CHECK(resumer->readyCount == 0 && resumed->readyIndex == -1); 
+}
+
+int main()
+{
+  check_scheduler(THREADKERNEL_SCHEDULER_LIST); 
+  check_scheduler(THREADKERNEL_SCHEDULER_HEAP); 
+  check_scheduler(THREADKERNEL_SCHEDULER_EDF); 
+  check_emptied(THREADKERNEL_SCHEDULER_HEAP); 
+  check_emptied(THREADKERNEL_SCHEDULER_EDF); 
+  check_resumed(THREADKERNEL_SCHEDULER_HEAP); 
+  check_resumed(THREADKERNEL_SCHEDULER_EDF); 
+  return 0; 
+}
@@ -0,0 +1,135 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    Checks that every signalled periodic process runs on the next pass under
+    the heap schedulers, even when the processes reorder the heap as they
+    run by changing their period, sleeping or suspending one another. Then
+    checks that a waiting immediate process costs no runs until signalled,
+    and that runs which report nothingToDo() count as wasted.
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#include "host.h"
+
+#define PROCESSES 16
+
+static threadkernel_t *k; 
+static process_t *processes[PROCESSES]; 
+static unsigned long runs[PROCESSES]; 
+static unsigned int round; 
+
+static void task(void *context)
+{
+  unsigned int i = (unsigned int)(uintptr_t)context; 
+  runs[i]++; 
+
+  // Each round moves the running process, or another, elsewhere in the heap.
+  if (round == 0)
+    k->setPeriod(k, k->current, 100000 - i * 1000); 
+  else if (round == 1)
+    k->sleep(k, 50000 + (i * 7919) % 40000); 
+  else
+    k->setPeriod(k, processes[(i * 5) % PROCESSES], 200000 + i * 1000); 
+}
+
+static void check_scheduler(threadkernel_scheduler_t scheduler)
+{
+  unsigned int i; 
+  timebase_use_virtual_clock(0); 
+
+  k = create_threadkernel_with_scheduler(&millis64, &micros64, 0, 0, scheduler); 
+  CHECK(k); 
+
+  for (i = 0; i < PROCESSES; i++)
+  {
+    processes[i] = k->addWithContext(k, task, (void *)(uintptr_t)i, 10000 + i * 10); 
+    CHECK(processes[i]); 
+  }
+
+  for (round = 0; round < 3; round++)
+  {
+    memset(runs, 0, sizeof(runs)); 
+
+    // Nothing is due, so only the signals run anything.
+    for (i = 0; i < PROCESSES; i++)
+      k->signal(k, processes[i]); 
+    k->run(k); 
+
+    for (i = 0; i < PROCESSES; i++)
+    {
+      if (runs[i] != 1)
+        fprintf(stderr, "scheduler %d round %u: process %u ran %lu times\n", scheduler, round, i, runs[i]); 
+      CHECK(runs[i] == 1); 
+    }
+  }
+}
+
+static unsigned int pending; 
+static unsigned long handled; 
+
+// Handles the pending events, if any, then waits to be signalled again.
+static void consumer()
+{
+  if (!pending)
+    k->nothingToDo(k); 
+
+  handled += pending; 
+  pending = 0; 
+  k->wait(k); 
+}
+
+static void check_wasted()
+{
+  timebase_use_virtual_clock(0); 
+  k = create_threadkernel(&millis64, &micros64, 0, 0); 
+  CHECK(k); 
+
+  // Outside a process, nothing is counted.
+  k->nothingToDo(k); 
+
+  // The first run finds nothing, and then the process waits, costing no runs.
+  process_t *p = k->addImmediate(k, consumer); 
+  CHECK(p); 
+  unsigned int i; 
+  for (i = 0; i < 100; i++)
+    k->run(k); 
+  CHECK(p->totalExecutions == 1 && p->wastedExecutions == 1); 
+
+  // A wakeup with an event to handle is useful.
+  pending = 3; 
+  k->signal(k, p); 
+  k->run(k); 
+  CHECK(handled == 3); 
+  CHECK(p->totalExecutions == 2 && p->wastedExecutions == 1); 
+
+  // One with nothing to handle is wasted.
+  k->signal(k, p); 
+  k->run(k); 
+  CHECK(p->totalExecutions == 3 && p->wastedExecutions == 2); 
+
+  for (i = 0; i < 100; i++)
+    k->run(k); 
+  CHECK(p->totalExecutions == 3); 
+}
+
+int main()
+{
+  check_scheduler(THREADKERNEL_SCHEDULER_HEAP); 
+  check_scheduler(THREADKERNEL_SCHEDULER_EDF); 
+  check_wasted(); 
+  return 0; 
+}
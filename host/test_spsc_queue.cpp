@@ -0,0 +1,122 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    Pushes numbered messages through an SPSCQueue from one std::thread to
+    another and checks that every one arrives, in order and whole. The second
+    round pops them from a kernel process which waits between batches and is
+    woken by the queue's signal, so a lost wakeup stalls it.
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#include <thread>
+#include "host.h"
+#include <SPSCQueue.h>
+
+#define MESSAGES 2000000ULL
+#define STALL_MILLIS 5000
+
+struct Message
+{
+  uint64_t sequence; 
+  uint64_t inverse; 
+  uint64_t product; 
+}; 
+
+static AOS::SPSCQueue<Message, 64> queue; 
+static threadkernel_t* consumerKernel; 
+static uint64_t received = 0; 
+static uint64_t damaged = 0; 
+
+static void receive(const Message& m)
+{
+  if (m.sequence != received || m.inverse != ~received || m.product != received * 0x9E3779B97F4A7C15ULL)
+    damaged++; 
+  received++; 
+}
+
+static void produce()
+{
+  for (uint64_t i = 0; i < MESSAGES; )
+  {
+    if (queue.push(Message{i, ~i, i * 0x9E3779B97F4A7C15ULL}))
+      i++; 
+    else
+      std::this_thread::yield(); 
+  }
+}
+
+static void consume_process()
+{
+  Message m; 
+  while (queue.pop(m))
+    receive(m); 
+
+  consumerKernel->wait(consumerKernel); 
+}
+
+int main()
+{
+  // Consumer polls.
+  std::thread producer(produce); 
+  std::thread consumer([] {
+    Message m; 
+    while (received < MESSAGES)
+    {
+      if (queue.pop(m))
+        receive(m); 
+      else
+        std::this_thread::yield(); 
+    }
+  }); 
+  producer.join(); 
+  consumer.join(); 
+
+  printf("polled: received %llu damaged %llu\n", (unsigned long long)received, (unsigned long long)damaged); 
+  CHECK(received == MESSAGES); 
+  CHECK(damaged == 0); 
+  CHECK(queue.isEmpty()); 
+
+  // Consumer is a waiting process, woken by each push.
+  received = 0; 
+  consumerKernel = create_threadkernel(&host_millis, &host_micros, 0, 0); 
+  process_t* process = consumerKernel->addImmediate(consumerKernel, consume_process); 
+  CHECK(process); 
+  queue.setConsumer(consumerKernel, process); 
+
+  std::thread signalledProducer(produce); 
+  uint64_t lastReceived = 0, lastProgress = host_millis(); 
+  while (received < MESSAGES)
+  {
+    consumerKernel->run(consumerKernel); 
+    std::this_thread::yield(); 
+
+    if (received != lastReceived)
+    {
+      lastReceived = received; 
+      lastProgress = host_millis(); 
+    }
+    CHECK(host_millis() - lastProgress < STALL_MILLIS); 
+  }
+  signalledProducer.join(); 
+
+  printf("signalled: received %llu damaged %llu runs %lu\n", (unsigned long long)received,
+    (unsigned long long)damaged, process->totalExecutions); 
+  CHECK(received == MESSAGES); 
+  CHECK(damaged == 0); 
+
+  return 0; 
+}
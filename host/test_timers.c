@@ -0,0 +1,161 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    Checks the timer wheel on the virtual clock with a pool of thousands of
+    timers spread from a few milliseconds to beyond the top level of the
+    wheel: none fires early or twice, cancelled ones never fire, and stale
+    handles are refused. Then checks that each kernel has its own pool, with
+    two kernels setting and firing timers on their own threads at once.
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#include <pthread.h>
+#include "host.h"
+
+#define TIMERS THREADKERNEL_MAX_TIMERS
+#define THREAD_TIMERS 200000
+
+static uint64_t expires[TIMERS]; 
+static unsigned long handles[TIMERS]; 
+static unsigned int fired[TIMERS]; 
+static unsigned long early, late; 
+
+static threadkernel_t *k; 
+
+/*
+  Each callback costs 10us, so the clock can pass into the next millisecond 
+  while a busy tick's timers are called; lateness is of the wheel's tick. 
+ */
+static void expire(void *context)
+{
+  unsigned int i = (unsigned int)(uintptr_t)context; 
+  fired[i]++; 
+
+  if (millis64() < expires[i])
+    early++; 
+  else if (k->timerWheelMillis != expires[i])
+    late++; 
+
+  timebase_advance_virtual_clock(10); 
+}
+
+static void count(void *context)
+{
+  (*(unsigned long *)context)++; 
+}
+
+// Keeps THREADKERNEL_MAX_TIMERS / 2 timers pending on its own kernel, for a
+// while, on the real clock.
+static void* churn(void *argument)
+{
+  threadkernel_t *k = (threadkernel_t *)argument; 
+  unsigned long set = 0, calls = 0; 
+
+  while(set < THREAD_TIMERS)
+  {
+    while(set < THREAD_TIMERS && k->timerCount < TIMERS / 2)
+    {
+      CHECK(k->after(k, set % 3, count, &calls)); 
+      set++; 
+    }
+    k->run(k); 
+  }
+  while(k->timerCount)
+    k->run(k); 
+
+  CHECK(calls == THREAD_TIMERS); 
+  return 0; 
+}
+
+int main()
+{
+  unsigned int i; 
+
+  timebase_use_virtual_clock(5000 * 1000ULL); 
+  k = create_threadkernel(&millis64, &micros64, 0, 0); 
+  CHECK(k); 
+  k->onIdle = host_virtual_idle; 
+
+  srand(1); 
+  for (i = 0; i < TIMERS; i++)
+  {
+    // A quarter each within level 0, 1, 2 and beyond the top of the wheel.
+    unsigned long delay = i % 4 == 0 ? rand() % 64
+      : i % 4 == 1 ? rand() % 4096
+      : i % 4 == 2 ? rand() % 400000
+      : 17000000 + rand() % 3000000; 
+    expires[i] = millis64() + delay; 
+    handles[i] = k->after(k, delay, expire, (void *)(uintptr_t)i); 
+    CHECK(handles[i]); 
+  }
+  CHECK(!k->after(k, 1, expire, 0)); 
+
+  unsigned int cancelled = 0; 
+  for (i = 0; i < TIMERS; i += 7)
+  {
+    CHECK(k->cancel(k, handles[i])); 
+    cancelled++; 
+  }
+  CHECK(!k->cancel(k, handles[0])); 
+  CHECK(!k->cancel(k, 0)); 
+  CHECK(!k->cancel(k, TIMERS + 1)); 
+
+  while(k->timerCount)
+    k->run(k); 
+
+  unsigned int total = 0; 
+  for (i = 0; i < TIMERS; i++)
+  {
+    total += fired[i]; 
+    CHECK(fired[i] == (i % 7 ? 1 : 0)); 
+  }
+  printf("fired %u cancelled %u early %lu late %lu dispatched %luus\n",
+    total, cancelled, early, late, (unsigned long)k->dispatchedMicros); 
+
+  CHECK(total + cancelled == TIMERS); 
+  CHECK(early == 0); 
+  CHECK(late == 0); 
+  CHECK(k->timersFired == total); 
+
+  // Callback time counts as dispatched work, not overhead.
+  CHECK(k->dispatchedMicros == 10ULL * total); 
+
+  // Handles of fired timers are stale, even once their slot is reused.
+  unsigned long reused = k->after(k, 1, expire, 0); 
+  CHECK(reused); 
+  CHECK(!k->cancel(k, handles[1])); 
+  CHECK(k->cancel(k, reused)); 
+
+  // Each kernel has a pool of its own, and refuses the other's handles.
+  threadkernel_t *k0 = create_threadkernel(&host_millis, &host_micros, 0, 0); 
+  threadkernel_t *k1 = create_threadkernel(&host_millis, &host_micros, 0, 0); 
+  CHECK(k0 && k1); 
+  unsigned long handle = k0->after(k0, 1000, count, 0); 
+  CHECK(handle); 
+  CHECK(!k1->cancel(k1, handle)); 
+  CHECK(k0->cancel(k0, handle)); 
+
+  pthread_t t0, t1; 
+  pthread_create(&t0, 0, churn, k0); 
+  pthread_create(&t1, 0, churn, k1); 
+  pthread_join(t0, 0); 
+  pthread_join(t1, 0); 
+
+  CHECK(k0->timersFired == THREAD_TIMERS && k1->timersFired == THREAD_TIMERS); 
+
+  return 0; 
+}
@@ -0,0 +1,83 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    Checks the trace ring: it keeps the most recent runs, oldest first, with
+    their durations, counts boots when it is attached again, and stays in
+    order across the point where a 32 bit microsecond clock wraps.
+
+    Author: Andrew Somerville <andy16666@gmail.com>
+    GitHub: andy16666
+ */
+#include "host.h"
+
+#define COST_MICROS 7
+
+static threadkernel_trace_t trace; 
+
+static void task() { timebase_advance_virtual_clock(COST_MICROS); }
+
+int main()
+{
+  unsigned int i; 
+
+  // Start a little before the low 32 bits of micros wrap.
+  uint64_t startMicros = (1ULL << 32) - 100 * COST_MICROS; 
+  timebase_use_virtual_clock(startMicros); 
+
+  threadkernel_t *k = create_threadkernel(&millis64, &micros64, 0, 0); 
+  CHECK(k); 
+  process_t *process = k->addImmediate(k, task); 
+  CHECK(process); 
+
+  memset(&trace, 0xA5, sizeof(trace)); 
+  threadkernel_attach_trace(k, &trace, 1); 
+  CHECK(threadkernel_trace_count(&trace) == 0); 
+  CHECK(trace.boot == 0); 
+
+  for (i = 0; i < THREADKERNEL_TRACE_RECORDS + 44; i++)
+    k->run(k); 
+
+  CHECK(threadkernel_trace_count(&trace) == THREADKERNEL_TRACE_RECORDS); 
+
+  uint64_t previous = 0; 
+  for (i = 0; i < THREADKERNEL_TRACE_RECORDS; i++)
+  {
+    threadkernel_trace_record_t *record = threadkernel_trace_record(&trace, i); 
+    CHECK(record->pid == process->pid); 
+    CHECK(record->core == 1); 
+    CHECK(record->boot == 0); 
+    CHECK(record->durationMicros == COST_MICROS); 
+    CHECK(record->startMicros > previous); 
+    previous = record->startMicros; 
+  }
+
+  // The oldest 44 records were overwritten, and the ring spans the wrap.
+  CHECK(threadkernel_trace_record(&trace, 0)->startMicros == startMicros + 44 * COST_MICROS); 
+  CHECK(threadkernel_trace_record(&trace, 0)->startMicros < (1ULL << 32)); 
+  CHECK(previous > (1ULL << 32)); 
+
+  // A reboot keeps the records and counts the boot.
+  threadkernel_attach_trace(k, &trace, 1); 
+  CHECK(trace.boot == 1); 
+  CHECK(threadkernel_trace_count(&trace) == THREADKERNEL_TRACE_RECORDS); 
+  k->run(k); 
+  CHECK(threadkernel_trace_record(&trace, THREADKERNEL_TRACE_RECORDS - 1)->boot == 1); 
+
+  threadkernel_reset_trace(&trace); 
+  CHECK(threadkernel_trace_count(&trace) == 0); 
+
+  return 0; 
+}
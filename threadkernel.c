@@ -14,189 +14,1618 @@
  */
 #include "threadkernel.h"
 
+static threadkernel_t kernelPool[THREADKERNEL_MAX_KERNELS]; 
+static unsigned int   kernelsUsed = 0; 
+
+/*
+  A process's pid is one more than its slot in this pool, which is shared by 
+  all kernels, so a pid alone identifies a process, for instance after a 
+  watchdog reboot, and maps straight back to it. Either core may add or 
+  remove processes at runtime, so taking and returning slots holds the lock 
+  set by threadkernel_set_lock. 
+ */
+static process_t      processPool[THREADKERNEL_MAX_PROCESSES]; 
+static unsigned int   processesUsed = 0; 
+static process_t*     freeProcesses = 0; 
+static unsigned int   processesFreed = 0; 
+static unsigned long  processAllocationFailures = 0; 
+
+/*
+  Migratable processes belong to no kernel's lists. There are few of them, so 
+  a kernel looking for one to run scans this array rather than keeping a heap. 
+ */
+static process_t*     migratableProcesses[THREADKERNEL_MAX_MIGRATABLE]; 
+static volatile unsigned int migratableCount = 0; 
+
+// Guards the process pool and migratableProcesses. See threadkernel_set_lock. 
+static void           (*sharedLock)() = 0; 
+static void           (*sharedUnlock)() = 0; 
+
 threadkernel_t* create_threadkernel
 (
-  unsigned long(*millis)(), 
-  void (*onMillisRollover)(), 
-  unsigned long(*micros)(), 
+  uint64_t (*millis)(), 
+  uint64_t (*micros)(), 
   void (*beforeProcess)(process_t*), 
   void (*afterProcess)(process_t*)
 ) 
 {
-  threadkernel_t* k = (threadkernel_t *)malloc(sizeof(threadkernel_t));
+  return create_threadkernel_with_scheduler(
+    millis, micros, beforeProcess, afterProcess, THREADKERNEL_SCHEDULER_LIST
+  ); 
+}
+
+threadkernel_t* create_threadkernel_with_scheduler
+(
+  uint64_t (*millis)(), 
+  uint64_t (*micros)(), 
+  void (*beforeProcess)(process_t*), 
+  void (*afterProcess)(process_t*), 
+  threadkernel_scheduler_t scheduler
+) 
+{
+  if (kernelsUsed >= THREADKERNEL_MAX_KERNELS)
+    return 0; 
+
+  threadkernel_t* k = &kernelPool[kernelsUsed++];
   
+  k->scheduler                 = scheduler; 
+  k->current                   = 0; 
+
   k->millis                    = millis; 
   k->micros                    = micros; 
 
   k->afterProcess              = afterProcess;
   k->beforeProcess             = beforeProcess; 
-  k->onMillisRollover          = onMillisRollover; 
 
   k->processes                 = 0; 
   k->immediateProcesses        = 0; 
+  k->heapCount                 = 0; 
+  k->readyCount                = 0; 
+  k->signalPending             = 0; 
+  k->removedProcesses          = 0; 
   k->add                       = __threadkernel_add; 
   k->addImmediate              = __threadkernel_addImmediate; 
+  k->addWithContext            = __threadkernel_add_with_context; 
+  k->addImmediateWithContext   = __threadkernel_add_immediate_with_context; 
+  k->addMigratable             = __threadkernel_add_migratable; 
   k->run                       = __threadkernel_run; 
+  k->after                     = __threadkernel_after; 
+  k->cancel                    = __threadkernel_cancel; 
   k->getProcessByPid           = __threadkernel_get_process_by_pid; 
+  k->firstProcess              = __threadkernel_first_process; 
+  k->nextProcess               = __threadkernel_next_process; 
+  k->signal                    = __threadkernel_signal; 
+  k->wait                      = __threadkernel_wait; 
+  k->nothingToDo               = __threadkernel_nothing_to_do; 
+  k->sleep                     = __threadkernel_sleep; 
+  k->remove                    = __threadkernel_remove; 
+  k->suspend                   = __threadkernel_suspend; 
+  k->resume                    = __threadkernel_resume; 
+  k->setPeriod                 = __threadkernel_set_period; 
+  k->setDeadline               = __threadkernel_set_deadline; 
+  k->setBudget                 = __threadkernel_set_budget; 
 
   k->totalExecutions           = 0; 
-  k->totalExecutionTimeSeconds = 0; 
+  k->trace                     = 0; 
+  k->traceCore                 = 0; 
+  k->timersUsed                = 0; 
+  k->freeTimers                = 0; 
+  memset(k->timerWheel, 0, sizeof(k->timerWheel)); 
+  k->timerWheelMillis          = millis(); 
+  k->timerCount                = 0; 
+  k->timersFired               = 0; 
+  k->migratableRuns            = 0; 
+  k->dispatches                = 0; 
+  k->dispatchedMicros          = 0; 
+  k->deadlineMisses            = 0; 
+  k->budgetOverruns            = 0; 
+  k->lastBudgetOverrunPid      = 0; 
+  k->totalExecutionMicros      = 0; 
+
+  k->onIdle                    = 0; 
+  k->onSignal                  = 0; 
+  k->idleMicros                = 0; 
+  k->createdMicros             = micros(); 
+  k->loadSampleMicros          = k->createdMicros; 
+  k->loadSampleBusyMicros      = 0; 
+  memset(k->load, 0, sizeof(k->load)); 
 
   return k;
 }
 
+unsigned int threadkernel_processes_available()
+{
+  return THREADKERNEL_MAX_PROCESSES - processesUsed + processesFreed; 
+}
+
+unsigned long threadkernel_process_allocation_failures()
+{
+  return processAllocationFailures; 
+}
+
+static inline void shared_lock()
+{
+  if (sharedLock)
+    sharedLock(); 
+}
+
+static inline void shared_unlock()
+{
+  if (sharedUnlock)
+    sharedUnlock(); 
+}
+
 static inline process_t* create_process(threadkernel_t *k, void(*f)()) 
 {
-  static unsigned int nextPid = 1; // PID 0 is a non-process. 
+  process_t* process = 0; 
+
+  shared_lock(); 
+  if (freeProcesses)
+  {
+    process = freeProcesses; 
+    freeProcesses = process->next; 
+    processesFreed--; 
+  }
+  else if (processesUsed < THREADKERNEL_MAX_PROCESSES)
+  {
+    process = &processPool[processesUsed++]; 
+  }
+  else 
+  {
+    processAllocationFailures++; 
+  }
+  shared_unlock(); 
 
-  process_t* process = (process_t*)malloc(sizeof(process_t)); 
-  process->pid = nextPid++;
+  if (!process)
+    return 0; 
+
+  process->pid = (process - processPool) + 1; // PID 0 is a non-process. 
+  process->kernel = k; 
 
   process->nextRunMilliseconds = 0;
 
+  process->deadlineMilliseconds = 0; 
+
   process->skippedExecutions = 0; 
+  process->deadlineMisses = 0; 
+  process->budgetMicros = 0; 
+  process->budgetOverruns = 0; 
+  process->migrations = 0; 
+  process->migratable = 0; 
+  process->running = 0; 
+  process->budgetPolicy = THREADKERNEL_BUDGET_REPORT; 
+  process->budgetShift = 0; 
   process->totalExecutions = 0; 
+  process->wastedExecutions = 0; 
+
+  process->totalExecutionMicros = 0; 
+  process->loadSampleMicros = 0; 
+  memset(process->load, 0, sizeof(process->load)); 
 
-  process->totalExecutionTimeSeconds = 0; 
+  memset(&process->executionMicros, 0, sizeof(process_histogram_t)); 
+  memset(&process->latenessMilliseconds, 0, sizeof(process_histogram_t)); 
+  memset(&process->overrunMilliseconds, 0, sizeof(process_histogram_t)); 
 
+  process->coroutineLine = 0; 
+  process->signalled = 0; 
+  process->waiting = 0; 
+  process->immediate = 0; 
+  process->suspended = 0; 
+  process->removed = 0; 
+  process->heapIndex = -1; 
+  process->readyIndex = -1; 
+  process->prev = 0; 
   process->next = 0; 
   process->f = f; 
+  process->fWithContext = 0; 
+  process->context = 0; 
 
   return process; 
 }
 
-process_t* __threadkernel_add(threadkernel_t *k, void(*f)(), unsigned long periodMilliseconds) 
+static inline void heap_swap(threadkernel_t *k, unsigned int i, unsigned int j)
 {
-  process_t** process_ptr = &(k->processes); 
-  while(*process_ptr) process_ptr = &((*process_ptr)->next); 
-  *process_ptr = create_process(k, f); 
-  (*process_ptr)->periodMilliseconds = periodMilliseconds; 
-  (*process_ptr)->nextRunMilliseconds = k->millis() + periodMilliseconds; 
-  
-  return *process_ptr; 
+  process_t *p = k->heap[i]; 
+  k->heap[i] = k->heap[j]; 
+  k->heap[j] = p; 
+
+  k->heap[i]->heapIndex = i; 
+  k->heap[j]->heapIndex = j; 
 }
 
-process_t* __threadkernel_addImmediate(threadkernel_t *k, void(*f)()) 
+static inline unsigned int heap_sift_up(threadkernel_t *k, unsigned int i)
 {
-  process_t** process_ptr = &(k->immediateProcesses); 
-  while(*process_ptr) process_ptr = &((*process_ptr)->next); 
-  *process_ptr = create_process(k, f); 
-  (*process_ptr)->periodMilliseconds = 0; 
-  (*process_ptr)->nextRunMilliseconds = 0; 
+  while(i > 0)
+  {
+    unsigned int parent = (i - 1) / 2; 
+    if (k->heap[parent]->nextRunMilliseconds <= k->heap[i]->nextRunMilliseconds)
+      break; 
+
+    heap_swap(k, i, parent); 
+    i = parent; 
+  }
 
-  return *process_ptr; 
+  return i; 
 }
 
-static inline process_t* get_by_pid(process_t *process, unsigned int pid)
+static inline void heap_sift_down(threadkernel_t *k, unsigned int i)
 {
-  while(process) 
+  while(1)
   {
-    if (process->pid == pid)
+    unsigned int left     = 2 * i + 1; 
+    unsigned int right    = left + 1; 
+    unsigned int smallest = i; 
+
+    if (left < k->heapCount && k->heap[left]->nextRunMilliseconds < k->heap[smallest]->nextRunMilliseconds)
+      smallest = left; 
+    if (right < k->heapCount && k->heap[right]->nextRunMilliseconds < k->heap[smallest]->nextRunMilliseconds)
+      smallest = right; 
+
+    if (smallest == i)
       break; 
 
-    process = process->next;  
+    heap_swap(k, i, smallest); 
+    i = smallest; 
   }
+}
 
-  return process; 
+// There are never more processes than THREADKERNEL_MAX_PROCESSES, so the heap cannot overflow. 
+static inline void heap_push(threadkernel_t *k, process_t *process)
+{
+  process->heapIndex = k->heapCount; 
+  k->heap[k->heapCount] = process; 
+  heap_sift_up(k, k->heapCount++); 
 }
 
-process_t* __threadkernel_get_process_by_pid(threadkernel_t *k, unsigned int pid)
+// Restores heap order after the key of the process at i changed. 
+static inline void heap_fix(threadkernel_t *k, unsigned int i)
 {
-  process_t *p = get_by_pid(k->immediateProcesses, pid); 
-  return p ? p : get_by_pid(k->processes, pid); 
+  heap_sift_down(k, heap_sift_up(k, i)); 
 }
 
-static inline void run_process(threadkernel_t *k, process_t *process)
+static inline void heap_remove(threadkernel_t *k, process_t *process)
 {
-  k->lastPid = process->pid; 
-  k->beforeProcess(process); 
+  unsigned int i = process->heapIndex; 
+  process->heapIndex = -1; 
 
-  unsigned long startMicros = k->micros(); 
-  process->f(); 
-  unsigned long endMicros   = k->micros(); 
+  if (i != --k->heapCount)
+  {
+    k->heap[i] = k->heap[k->heapCount]; 
+    k->heap[i]->heapIndex = i; 
+    heap_fix(k, i); 
+  }
+}
 
-  // Handle timer rollover. 
-  if (endMicros < startMicros)
-    endMicros = startMicros; 
+static inline int is_heap_scheduled(threadkernel_t *k, process_t *process)
+{
+  return k->scheduler != THREADKERNEL_SCHEDULER_LIST && !process->immediate && !process->migratable; 
+}
 
-  process->totalExecutionTimeSeconds += (endMicros - startMicros) / 1E6; 
+// Absolute deadline of the run of the process which is due at nextRunMilliseconds. 
+static inline uint64_t deadline_of(process_t *process)
+{
+  return process->nextRunMilliseconds 
+    + (process->deadlineMilliseconds ? process->deadlineMilliseconds : process->periodMilliseconds); 
+}
 
-  // Handle rollover by not incrementing the counter anymore. 
-  unsigned long previousTotalExecutions = process->totalExecutions; 
-  unsigned long newTotalExecutions = previousTotalExecutions + 1; 
-  if (previousTotalExecutions < newTotalExecutions)
+// The deadline which orders the process under THREADKERNEL_SCHEDULER_EDF, pushed back while it is demoted. 
+static inline uint64_t priority_deadline_of(process_t *process)
+{
+  if (process->budgetPolicy != THREADKERNEL_BUDGET_DEMOTE)
+    return deadline_of(process); 
+
+  return process->nextRunMilliseconds 
+    + ((uint64_t)(process->deadlineMilliseconds ? process->deadlineMilliseconds : process->periodMilliseconds) << process->budgetShift); 
+}
+
+static inline void list_append(process_t **head, process_t *process)
+{
+  process_t *prev = 0; 
+  while(*head) 
   {
-    process->totalExecutions = newTotalExecutions; 
+    prev = *head; 
+    head = &((*head)->next); 
   }
 
-  k->afterProcess(process); 
+  process->prev = prev; 
+  *head = process; 
 }
 
-static inline void run_immediate(threadkernel_t *k)
+/*
+  Unlinks the process but leaves its next pointer alone, so that a walk which 
+  is currently on it can still move on to the rest of the list. 
+ */
+static inline void list_unlink(process_t **head, process_t *process)
 {
-  process_t *process = k->immediateProcesses; 
+  if (process->prev)
+    process->prev->next = process->next; 
+  else 
+    *head = process->next; 
+
+  if (process->next)
+    process->next->prev = process->prev; 
+}
+
+process_t* __threadkernel_add(threadkernel_t *k, void(*f)(), unsigned long periodMilliseconds) 
+{
+  process_t* process = create_process(k, f); 
+  if (!process)
+    return 0; 
+
+  process->periodMilliseconds = periodMilliseconds; 
+  process->nextRunMilliseconds = k->millis() + periodMilliseconds; 
+  list_append(&(k->processes), process); 
+
+  if (is_heap_scheduled(k, process))
+    heap_push(k, process); 
   
-  while(process)
-  {
-    run_process(k, process); 
-    process = process->next; 
-  }
+  return process; 
 }
 
-void __threadkernel_run(threadkernel_t *k)
+process_t* __threadkernel_addImmediate(threadkernel_t *k, void(*f)()) 
 {
-  process_t* process = k->processes; 
-  unsigned long startMicros = k->micros(); 
+  process_t* process = create_process(k, f); 
+  if (!process)
+    return 0; 
+
+  process->periodMilliseconds = 0; 
+  process->nextRunMilliseconds = 0; 
+  process->immediate = 1; 
+  list_append(&(k->immediateProcesses), process); 
 
+  return process; 
+}
+
+process_t* __threadkernel_add_with_context(threadkernel_t *k, void (*f)(void *), void *context, unsigned long periodMilliseconds)
+{
+  process_t* process = __threadkernel_add(k, 0, periodMilliseconds); 
+  if (!process)
+    return 0; 
+
+  process->fWithContext = f; 
+  process->context = context; 
+
+  return process; 
+}
+
+process_t* __threadkernel_add_immediate_with_context(threadkernel_t *k, void (*f)(void *), void *context)
+{
+  process_t* process = __threadkernel_addImmediate(k, 0); 
+  if (!process)
+    return 0; 
+
+  process->fWithContext = f; 
+  process->context = context; 
+
+  return process; 
+}
+
+void threadkernel_set_lock(void (*lock)(), void (*unlock)())
+{
+  sharedLock = lock; 
+  sharedUnlock = unlock; 
+}
+
+process_t* __threadkernel_add_migratable(threadkernel_t *k, void(*f)(), unsigned long periodMilliseconds) 
+{
+  process_t* process = create_process(k, f); 
   if (!process)
+    return 0; 
+
+  process->periodMilliseconds = periodMilliseconds; 
+  process->nextRunMilliseconds = k->millis() + periodMilliseconds; 
+  process->migratable = 1; 
+
+  // Both cores may add at once, so the room left is checked under the lock, 
+  // and the slot handed back if there is none. 
+  shared_lock(); 
+  if (migratableCount >= THREADKERNEL_MAX_MIGRATABLE)
   {
-    run_immediate(k); 
+    processAllocationFailures++; 
+    process->kernel = 0; 
+    process->next = freeProcesses; 
+    freeProcesses = process; 
+    processesFreed++; 
+    process = 0; 
   }
-  
-  while(process)
+  else
   {
-    unsigned long startTimeMillis = k->millis(); 
-    if(startTimeMillis >= process->nextRunMilliseconds)
-    {
-      process->nextRunMilliseconds += process->periodMilliseconds;
+    migratableProcesses[migratableCount++] = process; 
+  }
+  shared_unlock(); 
 
-      run_process(k, process); 
-      
-      unsigned long endTimeMillis = k->millis(); 
-
-      // Handle timer rollover. 
-      if(endTimeMillis >= startTimeMillis)
-      {
-        while(endTimeMillis >= process->nextRunMilliseconds)
-        {
-          process->skippedExecutions++; 
-          process->nextRunMilliseconds += process->periodMilliseconds;
-        }
-      }
-      else 
-      {
-        k->onMillisRollover(); 
-      }
+  return process; 
+}
+
+static inline void migratable_unlink(process_t *process)
+{
+  unsigned int i; 
+  for (i = 0; i < migratableCount; i++)
+  {
+    if (migratableProcesses[i] == process)
+    {
+      migratableProcesses[i] = migratableProcesses[--migratableCount]; 
+      return; 
     }
-    
-    process = process->next; 
+  }
+}
 
-    run_immediate(k); 
+void __threadkernel_remove(threadkernel_t *k, process_t *process)
+{
+  if (process->removed)
+    return; 
+
+  if (process->migratable)
+  {
+    shared_lock(); 
+    migratable_unlink(process); 
+    int runningElsewhere = process->running && process->kernel != k; 
+    if (runningElsewhere)
+      process->removed = 2; 
+    shared_unlock(); 
+
+    // The kernel running it frees it once it returns. 
+    if (runningElsewhere)
+      return; 
   }
+  else 
+  {
+    if (process->heapIndex >= 0)
+      heap_remove(k, process); 
 
-  unsigned long endMicros   = k->micros(); 
-  
-  // Handle timer rollover. 
-  if (endMicros < startMicros)
-    endMicros = startMicros; 
+    list_unlink(process->immediate ? &(k->immediateProcesses) : &(k->processes), process); 
+  }
 
-  k->totalExecutionTimeSeconds += (endMicros - startMicros) / 1E6;
+  // A walk may still be holding it, so free it at the end of the pass. 
+  process->removed = 1; 
+  process->prev = k->removedProcesses; 
+  k->removedProcesses = process; 
+}
 
-  // Handle rollover by not incrementing the counter anymore. 
-  unsigned long previousTotalExecutions = k->totalExecutions; 
-  unsigned long newTotalExecutions = previousTotalExecutions + 1; 
-  if (previousTotalExecutions < newTotalExecutions)
+void __threadkernel_suspend(threadkernel_t *k, process_t *process)
+{
+  if (process->removed || process->suspended)
+    return; 
+
+  process->suspended = 1; 
+
+  if (process->heapIndex >= 0)
+    heap_remove(k, process); 
+}
+
+void __threadkernel_resume(threadkernel_t *k, process_t *process)
+{
+  if (process->removed || !process->suspended)
+    return; 
+
+  process->suspended = 0; 
+
+  if (!process->immediate)
   {
-    k->totalExecutions = newTotalExecutions; 
+    process->nextRunMilliseconds = k->millis() + process->periodMilliseconds; 
+
+    if (is_heap_scheduled(k, process))
+      heap_push(k, process); 
+  }
+}
+
+/*
+  The next run moves to one new period after the last scheduled run. 
+ */
+static inline void change_period(threadkernel_t *k, process_t *process, unsigned long periodMilliseconds)
+{
+  process->nextRunMilliseconds = process->nextRunMilliseconds - process->periodMilliseconds + periodMilliseconds; 
+  process->periodMilliseconds = periodMilliseconds; 
+
+  if (process->heapIndex >= 0)
+    heap_fix(k, process->heapIndex); 
+}
+
+void __threadkernel_set_period(threadkernel_t *k, process_t *process, unsigned long periodMilliseconds)
+{
+  if (process->removed || process->immediate)
+    return; 
+
+  // The new period replaces any backoff. 
+  if (process->budgetPolicy == THREADKERNEL_BUDGET_BACKOFF)
+    process->budgetShift = 0; 
+
+  change_period(k, process, periodMilliseconds); 
+}
+
+void __threadkernel_set_budget(threadkernel_t *k, process_t *process, unsigned long budgetMicros, threadkernel_budget_policy_t policy)
+{
+  // Undo any backoff under the old policy. 
+  if (process->budgetPolicy == THREADKERNEL_BUDGET_BACKOFF && process->budgetShift)
+    change_period(k, process, process->periodMilliseconds >> process->budgetShift); 
+
+  process->budgetMicros = budgetMicros; 
+  process->budgetPolicy = policy; 
+  process->budgetShift = 0; 
+}
+
+/*
+  Applies the process's budget policy to a run which took the given time. 
+ */
+static inline void check_budget(threadkernel_t *k, process_t *process, uint64_t executionMicros)
+{
+  if (!process->budgetMicros)
+    return; 
+
+  int backoff = process->budgetPolicy == THREADKERNEL_BUDGET_BACKOFF 
+             && !process->immediate && !process->removed; 
+
+  if (executionMicros > process->budgetMicros)
+  {
+    process->budgetOverruns++; 
+    k->budgetOverruns++; 
+    k->lastBudgetOverrunPid = process->pid; 
+
+    if (process->budgetPolicy == THREADKERNEL_BUDGET_REPORT || process->budgetShift >= THREADKERNEL_BUDGET_MAX_SHIFT)
+      return; 
+
+    process->budgetShift++; 
+    if (backoff)
+      change_period(k, process, process->periodMilliseconds << 1); 
+  }
+  else if (process->budgetShift)
+  {
+    process->budgetShift--; 
+    if (backoff)
+      change_period(k, process, process->periodMilliseconds >> 1); 
+  }
+}
+
+void __threadkernel_set_deadline(threadkernel_t *k, process_t *process, unsigned long deadlineMilliseconds)
+{
+  process->deadlineMilliseconds = deadlineMilliseconds; 
+}
+
+static inline void free_removed(threadkernel_t *k)
+{
+  if (!k->removedProcesses)
+    return; 
+
+  shared_lock(); 
+  while(k->removedProcesses)
+  {
+    process_t *process = k->removedProcesses; 
+    k->removedProcesses = process->prev; 
+
+    process->kernel = 0; 
+    process->next = freeProcesses; 
+    freeProcesses = process; 
+    processesFreed++; 
+  }
+  shared_unlock(); 
+}
+
+static inline void timer_link(threadkernel_t *k, threadkernel_timer_t *timer, unsigned int level, unsigned int slot)
+{
+  threadkernel_timer_t **head = &k->timerWheel[level][slot]; 
+
+  timer->level = level; 
+  timer->slot = slot; 
+  timer->prev = 0; 
+  timer->next = *head; 
+  if (*head)
+    (*head)->prev = timer; 
+  *head = timer; 
+}
+
+/*
+  Files the timer in the wheel slot which will be reached first at or before 
+  it is due, taking the level from how far away it is. 
+ */
+static inline void timer_insert(threadkernel_t *k, threadkernel_timer_t *timer)
+{
+  uint64_t expiresMilliseconds = timer->expiresMilliseconds; 
+  if (expiresMilliseconds <= k->timerWheelMillis)
+    expiresMilliseconds = k->timerWheelMillis + 1; 
+
+  uint64_t delta = expiresMilliseconds - k->timerWheelMillis; 
+  unsigned int level = 0; 
+  while(level < THREADKERNEL_TIMER_LEVELS - 1 && delta >= (1ULL << (THREADKERNEL_TIMER_SLOT_BITS * (level + 1))))
+    level++; 
+
+  // Beyond the top level: wait in the slot reached last and be placed again then. 
+  if (delta >= (1ULL << (THREADKERNEL_TIMER_SLOT_BITS * THREADKERNEL_TIMER_LEVELS)))
+    expiresMilliseconds = k->timerWheelMillis + (1ULL << (THREADKERNEL_TIMER_SLOT_BITS * THREADKERNEL_TIMER_LEVELS)) - 1; 
+
+  timer_link(k, timer, level, (expiresMilliseconds >> (THREADKERNEL_TIMER_SLOT_BITS * level)) & (THREADKERNEL_TIMER_SLOTS - 1)); 
+}
+
+static inline void timer_unlink(threadkernel_t *k, threadkernel_timer_t *timer)
+{
+  if (timer->prev)
+    timer->prev->next = timer->next; 
+  else 
+    k->timerWheel[timer->level][timer->slot] = timer->next; 
+
+  if (timer->next)
+    timer->next->prev = timer->prev; 
+}
+
+static inline void timer_free(threadkernel_t *k, threadkernel_timer_t *timer)
+{
+  timer->kernel = 0; 
+  timer->generation++; 
+  timer->next = k->freeTimers; 
+  k->freeTimers = timer; 
+}
+
+static inline unsigned long timer_handle(threadkernel_t *k, threadkernel_timer_t *timer)
+{
+  return ((unsigned long)timer->generation << 16) | (unsigned long)((timer - k->timerPool) + 1); 
+}
+
+/*
+  Each kernel takes timers from its own pool, and only on its own core, so 
+  the pools need no lock. 
+ */
+unsigned long __threadkernel_after(threadkernel_t *k, unsigned long milliseconds, void (*f)(void *), void *context)
+{
+  threadkernel_timer_t *timer; 
+
+  if (k->freeTimers)
+  {
+    timer = k->freeTimers; 
+    k->freeTimers = timer->next; 
+  }
+  else if (k->timersUsed < THREADKERNEL_MAX_TIMERS)
+  {
+    timer = &k->timerPool[k->timersUsed++]; 
+    timer->generation = 0; 
+  }
+  else 
+  {
+    return 0; 
+  }
+
+  // Restart a wheel which has been left idle just behind now, so that the 
+  // timer is not late, even if it is due now. 
+  uint64_t nowMillis = k->millis(); 
+  if (!k->timerCount)
+    k->timerWheelMillis = nowMillis ? nowMillis - 1 : 0; 
+
+  timer->expiresMilliseconds = nowMillis + milliseconds; 
+  timer->f = f; 
+  timer->context = context; 
+  timer->kernel = k; 
+  timer_insert(k, timer); 
+  k->timerCount++; 
+
+  return timer_handle(k, timer); 
+}
+
+int __threadkernel_cancel(threadkernel_t *k, unsigned long handle)
+{
+  unsigned long index = handle & 0xFFFF; 
+  if (index == 0 || index > k->timersUsed)
+    return 0; 
+
+  threadkernel_timer_t *timer = &k->timerPool[index - 1]; 
+  if (timer->kernel != k || timer_handle(k, timer) != handle)
+    return 0; 
+
+  timer_unlink(k, timer); 
+  timer_free(k, timer); 
+  k->timerCount--; 
+
+  return 1; 
+}
+
+/*
+  Moves every timer in a slot of an upper level down to where it now belongs. 
+  The cascade runs before the current tick's level 0 slot is, so a timer due 
+  on this very tick goes into that slot rather than the next one. 
+ */
+static inline void timer_cascade(threadkernel_t *k, unsigned int level)
+{
+  unsigned int slot = (k->timerWheelMillis >> (THREADKERNEL_TIMER_SLOT_BITS * level)) & (THREADKERNEL_TIMER_SLOTS - 1); 
+  threadkernel_timer_t *timer = k->timerWheel[level][slot]; 
+  k->timerWheel[level][slot] = 0; 
+
+  while(timer)
+  {
+    threadkernel_timer_t *next = timer->next; 
+    if (timer->expiresMilliseconds <= k->timerWheelMillis)
+      timer_link(k, timer, 0, k->timerWheelMillis & (THREADKERNEL_TIMER_SLOTS - 1)); 
+    else
+      timer_insert(k, timer); 
+    timer = next; 
   }
 }
+
+/*
+  Advances the wheel to now one tick at a time, calling the timers which fall 
+  due. A timer's slot is freed before it is called, so it may set another. 
+ */
+static inline void run_timers(threadkernel_t *k)
+{
+  uint64_t nowMillis = k->millis(); 
+
+  while(k->timerCount && k->timerWheelMillis < nowMillis)
+  {
+    k->timerWheelMillis++; 
+
+    int level; 
+    for (level = THREADKERNEL_TIMER_LEVELS - 1; level > 0; level--)
+    {
+      if (!(k->timerWheelMillis & ((1ULL << (THREADKERNEL_TIMER_SLOT_BITS * level)) - 1)))
+        timer_cascade(k, level); 
+    }
+
+    threadkernel_timer_t **head = &k->timerWheel[0][k->timerWheelMillis & (THREADKERNEL_TIMER_SLOTS - 1)]; 
+    while(*head)
+    {
+      threadkernel_timer_t *timer = *head; 
+      void (*f)(void *) = timer->f; 
+      void *context = timer->context; 
+
+      timer_unlink(k, timer); 
+      timer_free(k, timer); 
+      k->timerCount--; 
+      k->timersFired++; 
+
+      // Time in the callback is work done, not the kernel's overhead. 
+      uint64_t startMicros = k->micros(); 
+      f(context); 
+      k->dispatches++; 
+      k->dispatchedMicros += k->micros() - startMicros; 
+    }
+  }
+
+  if (!k->timerCount)
+    k->timerWheelMillis = nowMillis; 
+}
+
+/*
+  Milliseconds until the wheel next has to do anything: the next occupied 
+  slot of level 0, or the next cascade if there are none. It may be early 
+  but is never late. 
+ */
+static inline uint64_t millis_until_timer(threadkernel_t *k)
+{
+  if (!k->timerCount)
+    return UINT64_MAX; 
+
+  uint64_t nowMillis = k->millis(); 
+  if (nowMillis < k->timerWheelMillis)
+    nowMillis = k->timerWheelMillis; 
+
+  unsigned int ahead = THREADKERNEL_TIMER_SLOTS - (k->timerWheelMillis & (THREADKERNEL_TIMER_SLOTS - 1)); 
+  unsigned int i; 
+  for (i = 1; i < ahead; i++)
+  {
+    if (k->timerWheel[0][(k->timerWheelMillis + i) & (THREADKERNEL_TIMER_SLOTS - 1)])
+      break; 
+  }
+
+  uint64_t dueMillis = k->timerWheelMillis + i; 
+  return dueMillis > nowMillis ? dueMillis - nowMillis : 0; 
+}
+
+process_t* __threadkernel_get_process_by_pid(threadkernel_t *k, unsigned int pid)
+{
+  if (pid == 0 || pid > THREADKERNEL_MAX_PROCESSES)
+    return 0; 
+
+  process_t *p = &processPool[pid - 1]; 
+  return p->kernel == k && !p->removed ? p : 0; 
+}
+
+process_t* __threadkernel_first_process(threadkernel_t *k)
+{
+  return k->immediateProcesses ? k->immediateProcesses : k->processes; 
+}
+
+process_t* __threadkernel_next_process(threadkernel_t *k, process_t *process)
+{
+  if (process->next)
+    return process->next; 
+
+  return process->immediate ? k->processes : 0; 
+}
+
+static inline void histogram_add(process_histogram_t *h, uint64_t value64)
+{
+  unsigned long value = value64 > (unsigned long)-1 ? (unsigned long)-1 : (unsigned long)value64; 
+  unsigned int bucket = value ? (sizeof(unsigned long) * 8) - __builtin_clzl(value) : 0; 
+  if (bucket >= THREADKERNEL_HISTOGRAM_BUCKETS)
+    bucket = THREADKERNEL_HISTOGRAM_BUCKETS - 1; 
+
+  if (h->buckets[bucket] == UINT16_MAX)
+  {
+    unsigned int i; 
+    h->count = 0; 
+    for (i = 0; i < THREADKERNEL_HISTOGRAM_BUCKETS; i++)
+    {
+      h->buckets[i] >>= 1; 
+      h->count += h->buckets[i]; 
+    }
+  }
+
+  h->buckets[bucket]++; 
+  h->count++; 
+
+  if (value > h->max)
+    h->max = value; 
+}
+
+unsigned long process_histogram_percentile(process_histogram_t *h, unsigned int percentile)
+{
+  if (!h->count)
+    return 0; 
+
+  if (percentile > 100)
+    percentile = 100; 
+
+  // Rank of the sample we are looking for, rounded up and at least 1. 
+  unsigned long rank = (unsigned long)(((unsigned long long)h->count * percentile + 99) / 100); 
+  if (!rank)
+    rank = 1; 
+
+  unsigned long seen = 0; 
+  unsigned int bucket; 
+  for (bucket = 0; bucket < THREADKERNEL_HISTOGRAM_BUCKETS - 1; bucket++)
+  {
+    seen += h->buckets[bucket]; 
+    if (seen >= rank)
+      break; 
+  }
+
+  unsigned long upper = bucket ? (1UL << bucket) - 1 : 0; 
+  
+  return (bucket == THREADKERNEL_HISTOGRAM_BUCKETS - 1 || upper > h->max) ? h->max : upper; 
+}
+
+unsigned long process_histogram_p50(process_histogram_t *h) { return process_histogram_percentile(h, 50); }
+unsigned long process_histogram_p99(process_histogram_t *h) { return process_histogram_percentile(h, 99); }
+unsigned long process_histogram_max(process_histogram_t *h) { return h->max; }
+
+unsigned long threadkernel_dispatch_overhead_nanos(threadkernel_t *k)
+{
+  if (!k->dispatches || k->totalExecutionMicros < k->dispatchedMicros)
+    return 0; 
+
+  return (unsigned long)((k->totalExecutionMicros - k->dispatchedMicros) * 1000 / k->dispatches); 
+}
+
+void threadkernel_print_stats(threadkernel_t *k, FILE *out)
+{
+  process_t *process; 
+  for (process = k->firstProcess(k); process; process = k->nextProcess(k, process))
+  {
+    fprintf(out, 
+      "pid %u period %lums runs %lu wasted %lu skipped %lu missed %lu overruns %lu "
+      "exec p50/p99/max %lu/%lu/%luus late p50/p99/max %lu/%lu/%lums\n", 
+      process->pid, process->periodMilliseconds, 
+      process->totalExecutions, process->wastedExecutions, 
+      process->skippedExecutions, process->deadlineMisses, process->budgetOverruns, 
+      process_histogram_p50(&process->executionMicros), 
+      process_histogram_p99(&process->executionMicros), 
+      process_histogram_max(&process->executionMicros), 
+      process_histogram_p50(&process->latenessMilliseconds), 
+      process_histogram_p99(&process->latenessMilliseconds), 
+      process_histogram_max(&process->latenessMilliseconds)
+    ); 
+  }
+
+  fprintf(out, 
+    "passes %lu busy %lluus idle %lluus missed %lu overruns %lu dispatches %lu overhead %luns\n", 
+    k->totalExecutions, 
+    (unsigned long long)k->totalExecutionMicros, 
+    (unsigned long long)k->idleMicros, 
+    k->deadlineMisses, 
+    k->budgetOverruns, 
+    k->dispatches, 
+    threadkernel_dispatch_overhead_nanos(k)
+  ); 
+}
+
+void __threadkernel_signal(threadkernel_t *k, process_t *process)
+{
+  // Publish anything written before the signal, then the process flag, then the kernel flag. 
+  __sync_synchronize(); 
+  process->signalled = 1; 
+  __sync_synchronize(); 
+  k->signalPending = 1; 
+
+  if (k->onSignal)
+    k->onSignal(); 
+}
+
+/*
+  Consumes a signal. The flag is cleared before the process runs so that a 
+  signal arriving while it runs is not lost. 
+ */
+static inline int take_signal(process_t *process)
+{
+  if (!process->signalled)
+    return 0; 
+
+  process->signalled = 0; 
+  __sync_synchronize(); 
+  return 1; 
+}
+
+/*
+  Consumes any signal and returns whether the process may run, which is when 
+  it is not waiting or has just been signalled. 
+ */
+static inline int take_ready(process_t *process)
+{
+  if (process->suspended || process->removed)
+    return 0; 
+
+  if (take_signal(process))
+  {
+    process->waiting = 0; 
+    return 1; 
+  }
+
+  return !process->waiting; 
+}
+
+/*
+  Consumes a signal which arrived before the process was due, returning 
+  whether it should run now. 
+ */
+static inline int take_woken(process_t *process)
+{
+  if (process->suspended || process->removed || !take_signal(process))
+    return 0; 
+
+  process->waiting = 0; 
+  return 1; 
+}
+
+void __threadkernel_wait(threadkernel_t *k)
+{
+  if (k->current)
+    k->current->waiting = 1; 
+}
+
+void __threadkernel_nothing_to_do(threadkernel_t *k)
+{
+  if (k->current)
+    k->current->wastedExecutions++; 
+}
+
+void threadkernel_reset_trace(threadkernel_trace_t *trace)
+{
+  trace->next = 0; 
+  trace->boot = 0; 
+  trace->magic = THREADKERNEL_TRACE_MAGIC; 
+}
+
+void threadkernel_attach_trace(threadkernel_t *k, threadkernel_trace_t *trace, unsigned char core)
+{
+  if (trace->magic != THREADKERNEL_TRACE_MAGIC)
+    threadkernel_reset_trace(trace); 
+  else 
+    trace->boot++; 
+
+  k->traceCore = core; 
+  k->trace = trace; 
+}
+
+unsigned int threadkernel_trace_count(threadkernel_trace_t *trace)
+{
+  return trace->next < THREADKERNEL_TRACE_RECORDS ? trace->next : THREADKERNEL_TRACE_RECORDS; 
+}
+
+threadkernel_trace_record_t* threadkernel_trace_record(threadkernel_trace_t *trace, unsigned int i)
+{
+  uint32_t first = trace->next - threadkernel_trace_count(trace); 
+  return &trace->records[(first + i) & (THREADKERNEL_TRACE_RECORDS - 1)]; 
+}
+
+static inline threadkernel_trace_record_t* trace_begin(threadkernel_t *k, process_t *process, uint64_t startMicros)
+{
+  threadkernel_trace_t *trace = k->trace; 
+  if (!trace)
+    return 0; 
+
+  threadkernel_trace_record_t *record = &trace->records[trace->next & (THREADKERNEL_TRACE_RECORDS - 1)]; 
+  record->startMicros    = startMicros; 
+  record->durationMicros = THREADKERNEL_TRACE_RUNNING; 
+  record->pid            = process->pid; 
+  record->core           = k->traceCore; 
+  record->boot           = trace->boot; 
+  trace->next++; 
+
+  return record; 
+}
+
+/*
+  Immediate processes have a nextRunMilliseconds of 0 unless they are asleep. 
+ */
+void __threadkernel_sleep(threadkernel_t *k, unsigned long milliseconds)
+{
+  process_t *process = k->current; 
+  if (!process)
+    return; 
+
+  process->nextRunMilliseconds = k->millis() + milliseconds; 
+
+  if (process->heapIndex >= 0)
+    heap_fix(k, process->heapIndex); 
+}
+
+static inline void run_process(threadkernel_t *k, process_t *process)
+{
+  k->lastPid = process->pid; 
+  k->current = process; 
+  if (k->beforeProcess)
+    k->beforeProcess(process); 
+
+  uint64_t startMicros = k->micros(); 
+  threadkernel_trace_record_t *record = trace_begin(k, process, startMicros); 
+  if (process->fWithContext)
+    process->fWithContext(process->context); 
+  else 
+    process->f(); 
+  uint64_t endMicros   = k->micros(); 
+
+  if (record)
+    record->durationMicros = (uint32_t)(endMicros - startMicros); 
+
+  process->totalExecutionMicros += endMicros - startMicros; 
+  histogram_add(&process->executionMicros, endMicros - startMicros); 
+
+  k->dispatches++; 
+  k->dispatchedMicros += endMicros - startMicros; 
+
+  check_budget(k, process, endMicros - startMicros); 
+
+  // Handle rollover by not incrementing the counter anymore. 
+  unsigned long previousTotalExecutions = process->totalExecutions; 
+  unsigned long newTotalExecutions = previousTotalExecutions + 1; 
+  if (previousTotalExecutions < newTotalExecutions)
+  {
+    process->totalExecutions = newTotalExecutions; 
+  }
+
+  k->current = 0; 
+  if (k->afterProcess)
+    k->afterProcess(process); 
+}
+
+/*
+  Consumes any signal and returns whether the immediate process may run, which 
+  is when it is ready and not asleep. A signal ends a sleep early. 
+ */
+static inline int take_ready_immediate(threadkernel_t *k, process_t *process)
+{
+  if (process->nextRunMilliseconds && !process->signalled)
+  {
+    if (k->millis() < process->nextRunMilliseconds)
+      return 0; 
+  }
+
+  if (!take_ready(process))
+    return 0; 
+
+  process->nextRunMilliseconds = 0; 
+  return 1; 
+}
+
+static inline void run_immediate(threadkernel_t *k)
+{
+  process_t *process = k->immediateProcesses; 
+  
+  while(process)
+  {
+    if (take_ready_immediate(k, process))
+      run_process(k, process); 
+
+    process = process->next; 
+  }
+}
+
+/*
+  Runs a periodic process which is due and advances its nextRunMilliseconds, 
+  counting any periods which were missed while it ran. 
+ */
+static inline void run_periodic(threadkernel_t *k, process_t *process, uint64_t startTimeMillis)
+{
+  uint64_t deadlineMillis = deadline_of(process); 
+
+  histogram_add(&process->latenessMilliseconds, startTimeMillis - process->nextRunMilliseconds); 
+
+  process->nextRunMilliseconds += process->periodMilliseconds;
+
+  run_process(k, process); 
+  
+  uint64_t endTimeMillis = k->millis(); 
+
+  if (endTimeMillis > deadlineMillis)
+  {
+    process->deadlineMisses++; 
+    k->deadlineMisses++; 
+    histogram_add(&process->overrunMilliseconds, endTimeMillis - deadlineMillis); 
+  }
+
+  while(endTimeMillis >= process->nextRunMilliseconds && process->periodMilliseconds)
+  {
+    process->skippedExecutions++; 
+    process->nextRunMilliseconds += process->periodMilliseconds;
+  }
+}
+
+/*
+  Moves a due process which is waiting on to its next period without running it. 
+ */
+static inline void pass_periodic(process_t *process, uint64_t startTimeMillis)
+{
+  while(startTimeMillis >= process->nextRunMilliseconds && process->periodMilliseconds)
+  {
+    process->nextRunMilliseconds += process->periodMilliseconds;
+  }
+}
+
+/*
+  Runs a periodic process which is due, or passes over it if it is waiting. 
+ */
+static inline void run_due(threadkernel_t *k, process_t *process, uint64_t startTimeMillis)
+{
+  if (take_ready(process))
+    run_periodic(k, process, startTimeMillis); 
+  else 
+    pass_periodic(process, startTimeMillis); 
+}
+
+static inline void run_list(threadkernel_t *k)
+{
+  process_t* process = k->processes; 
+
+  // Signalled processes are found by the walk itself. 
+  k->signalPending = 0; 
+  __sync_synchronize(); 
+
+  if (!process)
+  {
+    run_immediate(k); 
+  }
+  
+  while(process)
+  {
+    uint64_t startTimeMillis = k->millis(); 
+    if(startTimeMillis >= process->nextRunMilliseconds)
+    {
+      run_due(k, process, startTimeMillis); 
+    }
+    else if (take_woken(process))
+    {
+      run_process(k, process); 
+    }
+    
+    process = process->next; 
+
+    run_immediate(k); 
+  }
+}
+
+/*
+  Runs the signalled periodic processes which are not yet due. Their schedule 
+  is left alone. Only the heap needs scanning; immediate processes run every pass. 
+  The signalled processes are copied out first, because a process which calls 
+  setPeriod, remove, suspend or sleep reorders the heap under the scan. The 
+  ready set is empty at this point in a pass, so it holds the copy. 
+ */
+static inline void run_signalled(threadkernel_t *k)
+{
+  if (!k->signalPending)
+    return; 
+
+  k->signalPending = 0; 
+  __sync_synchronize(); 
+
+  unsigned int i, count = 0; 
+  for (i = 0; i < k->heapCount; i++)
+  {
+    if (k->heap[i]->signalled)
+      k->ready[count++] = k->heap[i]; 
+  }
+
+  // A process signalled since the copy sets signalPending again, so it runs next pass. 
+  for (i = 0; i < count; i++)
+  {
+    process_t *process = k->ready[i]; 
+    if (take_woken(process))
+      run_process(k, process); 
+  }
+}
+
+static inline void run_heap(threadkernel_t *k)
+{
+  run_signalled(k); 
+
+  // Visit each process at most once per pass, even if it is due again. A 
+  // process may empty the heap as it runs, so check it is not empty too. 
+  unsigned int remaining = k->heapCount; 
+  unsigned int executed = 0; 
+
+  while(remaining-- && k->heapCount)
+  {
+    process_t *process = k->heap[0]; 
+    uint64_t startTimeMillis = k->millis(); 
+    if (startTimeMillis < process->nextRunMilliseconds)
+      break; 
+
+    run_due(k, process, startTimeMillis); 
+
+    // The process may have removed, suspended or re-periodized itself. 
+    if (process->heapIndex >= 0)
+      heap_fix(k, process->heapIndex); 
+    executed++; 
+
+    run_immediate(k); 
+  }
+
+  if (!executed)
+  {
+    run_immediate(k); 
+  }
+}
+
+/*
+  Moves every process which is due off the heap and into the ready set. A 
+  process suspended and resumed while in the ready set is on the heap as well; 
+  it keeps its one place in the ready set. 
+ */
+static inline void release_due(threadkernel_t *k, uint64_t nowMillis)
+{
+  while(k->heapCount && k->heap[0]->nextRunMilliseconds <= nowMillis)
+  {
+    process_t *process = k->heap[0]; 
+    heap_remove(k, process); 
+
+    if (process->readyIndex < 0)
+    {
+      process->readyIndex = k->readyCount; 
+      k->ready[k->readyCount++] = process; 
+    }
+  }
+}
+
+/*
+  Takes the ready process with the earliest deadline out of the ready set. 
+  There are few enough processes that a scan beats keeping a second heap. 
+ */
+static inline process_t* take_earliest_deadline(threadkernel_t *k)
+{
+  unsigned int earliest = 0; 
+  unsigned int i; 
+  for (i = 1; i < k->readyCount; i++)
+  {
+    if (priority_deadline_of(k->ready[i]) < priority_deadline_of(k->ready[earliest]))
+      earliest = i; 
+  }
+
+  process_t *process = k->ready[earliest]; 
+  k->ready[earliest] = k->ready[--k->readyCount]; 
+  k->ready[earliest]->readyIndex = earliest; 
+  process->readyIndex = -1; 
+  return process; 
+}
+
+/*
+  Puts a process taken off the heap back on it, unless it has been removed or 
+  suspended in the meantime, or resumed and so pushed back already. 
+ */
+static inline void requeue(threadkernel_t *k, process_t *process)
+{
+  if (process->removed || process->suspended)
+    return; 
+
+  if (process->heapIndex >= 0)
+    heap_fix(k, process->heapIndex); 
+  else 
+    heap_push(k, process); 
+}
+
+static inline void run_edf(threadkernel_t *k)
+{
+  run_signalled(k); 
+
+  // Visit each process at most once per pass, even if it is due again. 
+  unsigned int remaining = k->heapCount; 
+
+  release_due(k, k->millis()); 
+
+  while(k->readyCount && remaining--)
+  {
+    process_t *process = take_earliest_deadline(k); 
+
+    run_due(k, process, k->millis()); 
+
+    requeue(k, process); 
+
+    release_due(k, k->millis()); 
+  }
+
+  // Anything left over is run first on the next pass. 
+  while(k->readyCount)
+  {
+    process_t *process = k->ready[--k->readyCount]; 
+    process->readyIndex = -1; 
+    requeue(k, process); 
+  }
+
+  run_immediate(k); 
+}
+
+/*
+  Milliseconds until anything can run: 0 if an immediate process is ready or 
+  a signal is pending, otherwise the time until the next periodic process is 
+  due or a sleeping immediate process wakes. Waiting periodic processes are ignored in list mode; in heap mode only 
+  the top of the heap is considered. 
+ */
+static inline uint64_t millis_until_due(threadkernel_t *k)
+{
+  if (k->signalPending)
+    return 0; 
+
+  uint64_t nextRunMilliseconds = UINT64_MAX; 
+  process_t *process; 
+  for (process = k->immediateProcesses; process; process = process->next)
+  {
+    if (process->suspended || (process->waiting && !process->signalled))
+      continue; 
+
+    if (!process->nextRunMilliseconds || process->signalled)
+      return 0; 
+
+    // Asleep. 
+    if (process->nextRunMilliseconds < nextRunMilliseconds)
+      nextRunMilliseconds = process->nextRunMilliseconds; 
+  }
+
+  if (k->scheduler != THREADKERNEL_SCHEDULER_LIST)
+  {
+    if (k->heapCount && k->heap[0]->nextRunMilliseconds < nextRunMilliseconds)
+      nextRunMilliseconds = k->heap[0]->nextRunMilliseconds; 
+  }
+  else 
+  {
+    for (process = k->processes; process; process = process->next)
+    {
+      if (!process->waiting && !process->suspended && process->nextRunMilliseconds < nextRunMilliseconds)
+        nextRunMilliseconds = process->nextRunMilliseconds; 
+    }
+  }
+
+  if (nextRunMilliseconds == UINT64_MAX)
+    return UINT64_MAX; 
+
+  uint64_t nowMilliseconds = k->millis(); 
+
+  return nextRunMilliseconds > nowMilliseconds ? nextRunMilliseconds - nowMilliseconds : 0; 
+}
+
+/*
+  Picks the migratable process which is due soonest, or has been signalled, 
+  and claims it for k. 
+ */
+static inline process_t* claim_migratable(threadkernel_t *k, uint64_t nowMillis, int overdueOnly)
+{
+  process_t *claimed = 0; 
+
+  shared_lock(); 
+
+  unsigned int i; 
+  for (i = 0; i < migratableCount; i++)
+  {
+    process_t *process = migratableProcesses[i]; 
+    if (process->running || process->suspended)
+      continue; 
+
+    if (process->nextRunMilliseconds > nowMillis && !process->signalled)
+      continue; 
+
+    if (overdueOnly && process->nextRunMilliseconds + process->periodMilliseconds > nowMillis)
+      continue; 
+
+    if (!claimed || process->nextRunMilliseconds < claimed->nextRunMilliseconds)
+      claimed = process; 
+  }
+
+  if (claimed)
+  {
+    claimed->running = 1; 
+    if (claimed->kernel != k)
+    {
+      claimed->migrations++; 
+      claimed->kernel = k; 
+    }
+  }
+
+  shared_unlock(); 
+
+  return claimed; 
+}
+
+/*
+  Runs one migratable process if k has nothing of its own ready. A kernel 
+  which is never idle, such as one with an immediate process that is always 
+  ready, still runs one which is a whole period overdue, so that migratable 
+  processes are not starved when every kernel is busy. 
+ */
+static inline void run_migratable(threadkernel_t *k)
+{
+  if (!migratableCount)
+    return; 
+
+  int busy = millis_until_due(k) == 0; 
+  uint64_t startTimeMillis = k->millis(); 
+  process_t *process = claim_migratable(k, startTimeMillis, busy); 
+  if (!process)
+    return; 
+
+  if (startTimeMillis >= process->nextRunMilliseconds)
+    run_due(k, process, startTimeMillis); 
+  else if (take_woken(process))
+    run_process(k, process); 
+
+  k->migratableRuns++; 
+
+  shared_lock(); 
+  process->running = 0; 
+  int removedElsewhere = process->removed == 2; 
+  shared_unlock(); 
+
+  if (removedElsewhere)
+  {
+    process->removed = 1; 
+    process->prev = k->removedProcesses; 
+    k->removedProcesses = process; 
+  }
+}
+
+/*
+  Milliseconds until a migratable process is due, or 0 if one is signalled. 
+ */
+static inline uint64_t millis_until_migratable_due(threadkernel_t *k)
+{
+  uint64_t nextRunMilliseconds = UINT64_MAX; 
+
+  shared_lock(); 
+
+  unsigned int i; 
+  for (i = 0; i < migratableCount; i++)
+  {
+    process_t *process = migratableProcesses[i]; 
+    if (process->running || process->suspended)
+      continue; 
+
+    if (process->signalled)
+      nextRunMilliseconds = 0; 
+    else if (!process->waiting && process->nextRunMilliseconds < nextRunMilliseconds)
+      nextRunMilliseconds = process->nextRunMilliseconds; 
+  }
+
+  shared_unlock(); 
+
+  if (nextRunMilliseconds == UINT64_MAX)
+    return UINT64_MAX; 
+
+  uint64_t nowMilliseconds = k->millis(); 
+
+  return nextRunMilliseconds > nowMilliseconds ? nextRunMilliseconds - nowMilliseconds : 0; 
+}
+
+// 1 - e^(-T/tau) for T = 250ms and tau = 1s, 10s and 60s, scaled by THREADKERNEL_LOAD_ONE. 
+static const int32_t loadFactors[THREADKERNEL_LOAD_AVERAGES] = { 14497, 1618, 272 }; 
+
+static inline void load_add(uint32_t load[THREADKERNEL_LOAD_AVERAGES], uint64_t busyMicros, uint64_t elapsedMicros, unsigned int samples)
+{
+  int32_t utilisation = busyMicros >= elapsedMicros 
+    ? THREADKERNEL_LOAD_ONE 
+    : (int32_t)(busyMicros * THREADKERNEL_LOAD_ONE / elapsedMicros); 
+
+  unsigned int i; 
+  for (i = 0; i < THREADKERNEL_LOAD_AVERAGES; i++)
+  {
+    // Apply one step per sample period so long idles decay at the right rate. 
+    unsigned int sample; 
+    for (sample = 0; sample < samples; sample++)
+      load[i] += ((utilisation - (int32_t)load[i]) * loadFactors[i]) >> 16; 
+  }
+}
+
+/*
+  Samples the load averages of k and its processes once every 
+  THREADKERNEL_LOAD_SAMPLE_MICROS. 
+ */
+static inline void sample_load(threadkernel_t *k)
+{
+  uint64_t nowMicros = k->micros(); 
+  uint64_t elapsedMicros = nowMicros - k->loadSampleMicros; 
+  if (elapsedMicros < THREADKERNEL_LOAD_SAMPLE_MICROS)
+    return; 
+
+  // 240 samples cover the 60s average; any more only take time. 
+  uint64_t samples = elapsedMicros / THREADKERNEL_LOAD_SAMPLE_MICROS; 
+  if (samples > 240)
+    samples = 240; 
+
+  load_add(k->load, k->totalExecutionMicros - k->loadSampleBusyMicros, elapsedMicros, samples); 
+  k->loadSampleBusyMicros = k->totalExecutionMicros; 
+  k->loadSampleMicros = nowMicros; 
+
+  process_t *process; 
+  for (process = k->firstProcess(k); process; process = k->nextProcess(k, process))
+  {
+    load_add(process->load, process->totalExecutionMicros - process->loadSampleMicros, elapsedMicros, samples); 
+    process->loadSampleMicros = process->totalExecutionMicros; 
+  }
+}
+
+float threadkernel_load_percent(const uint32_t load[THREADKERNEL_LOAD_AVERAGES], unsigned int average)
+{
+  return 100.0f * load[average] / THREADKERNEL_LOAD_ONE; 
+}
+
+static inline void idle(threadkernel_t *k)
+{
+  if (!k->onIdle)
+    return; 
+
+  uint64_t milliseconds = millis_until_due(k); 
+  if (milliseconds && k->timerCount)
+  {
+    uint64_t timerMilliseconds = millis_until_timer(k); 
+    if (timerMilliseconds < milliseconds)
+      milliseconds = timerMilliseconds; 
+  }
+
+  if (milliseconds && migratableCount)
+  {
+    uint64_t migratableMilliseconds = millis_until_migratable_due(k); 
+    if (migratableMilliseconds < milliseconds)
+      milliseconds = migratableMilliseconds; 
+  }
+  if (!milliseconds)
+    return; 
+
+  uint64_t startMicros = k->micros(); 
+  k->onIdle(k, milliseconds); 
+  k->idleMicros += k->micros() - startMicros; 
+}
+
+void __threadkernel_run(threadkernel_t *k)
+{
+  uint64_t startMicros = k->micros(); 
+
+  run_timers(k); 
+
+  if (k->scheduler == THREADKERNEL_SCHEDULER_EDF)
+    run_edf(k); 
+  else if (k->scheduler == THREADKERNEL_SCHEDULER_HEAP)
+    run_heap(k); 
+  else 
+    run_list(k); 
+
+  run_migratable(k); 
+
+  uint64_t endMicros   = k->micros(); 
+
+  k->totalExecutionMicros += endMicros - startMicros;
+
+  // Handle rollover by not incrementing the counter anymore. 
+  unsigned long previousTotalExecutions = k->totalExecutions; 
+  unsigned long newTotalExecutions = previousTotalExecutions + 1; 
+  if (previousTotalExecutions < newTotalExecutions)
+  {
+    k->totalExecutions = newTotalExecutions; 
+  }
+
+  free_removed(k); 
+
+  sample_load(k); 
+
+  idle(k); 
+}
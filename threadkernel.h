@@ -23,67 +23,526 @@
 #define THREADKRNEL_HH
 #define threadkernel_t struct threadkernel_t_t
 #define process_t      struct process_t_t
+#define process_histogram_t struct process_histogram_t_t
+#define threadkernel_trace_t struct threadkernel_trace_t_t
+#define threadkernel_trace_record_t struct threadkernel_trace_record_t_t
+#define threadkernel_timer_t struct threadkernel_timer_t_t
 #include <sys/types.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+/*
+  Kernels and processes come from fixed pools so that nothing is allocated 
+  from the heap. These sizes, and THREADKERNEL_MAX_TIMERS and 
+  THREADKERNEL_TRACE_RECORDS below, also size arrays inside threadkernel_t 
+  and threadkernel_trace_t, so every file which includes threadkernel.h must 
+  see the same values as threadkernel.c. Set them for the whole build with 
+  -D compiler flags; defining them before one #include would give that file 
+  a different layout of the structs from the kernel's. 
+ */
+#ifndef THREADKERNEL_MAX_KERNELS
+#define THREADKERNEL_MAX_KERNELS 2
+#endif
+
+#ifndef THREADKERNEL_MAX_PROCESSES
+#define THREADKERNEL_MAX_PROCESSES 64
+#endif
+
+// One-shot timers for each kernel. See after(). 
+#ifndef THREADKERNEL_MAX_TIMERS
+#define THREADKERNEL_MAX_TIMERS 32
+#endif
+
+/*
+  Timers are kept in a hierarchical wheel of 1ms ticks. Level 0 holds timers 
+  due within 64ms, one per slot; each further level covers 64 times the span 
+  of the one below, and its slots are moved down a level as the wheel reaches 
+  them. Four levels reach ~4.6 hours; later timers wait in the top level and 
+  are placed again when it comes round. 
+ */
+#define THREADKERNEL_TIMER_LEVELS     4
+#define THREADKERNEL_TIMER_SLOT_BITS  6
+#define THREADKERNEL_TIMER_SLOTS      (1 << THREADKERNEL_TIMER_SLOT_BITS)
+
+// Processes which any kernel may run. See addMigratable. 
+#ifndef THREADKERNEL_MAX_MIGRATABLE
+#define THREADKERNEL_MAX_MIGRATABLE 16
+#endif
+
+/*
+  Records kept by a trace ring. Must be a power of two. 
+ */
+#ifndef THREADKERNEL_TRACE_RECORDS
+#define THREADKERNEL_TRACE_RECORDS 256
+#endif
+
+#if (THREADKERNEL_TRACE_RECORDS & (THREADKERNEL_TRACE_RECORDS - 1)) != 0
+#error "THREADKERNEL_TRACE_RECORDS must be a power of two"
+#endif
+
+// Changed whenever the layout of a trace changes, so that a ring left in 
+// memory by older firmware is reset rather than misread. 
+#define THREADKERNEL_TRACE_MAGIC   0x54524332UL
+
+// durationMicros of a process which had not finished when the record was read, 
+// or when the core was reset. 
+#define THREADKERNEL_TRACE_RUNNING UINT32_MAX
+
+/*
+  Histogram bucket i counts values whose bit length is i, so bucket 0 holds 0, 
+  bucket 1 holds 1, bucket 2 holds 2-3 and so on. The last bucket also holds 
+  everything larger. 24 buckets cover up to ~8.4s in microseconds. 
+ */
+#define THREADKERNEL_HISTOGRAM_BUCKETS 24
+
+/*
+  Load averages are exponential moving averages of the fraction of time spent 
+  running, sampled every THREADKERNEL_LOAD_SAMPLE_MICROS, over roughly 1s, 10s 
+  and 60s. They are fixed point, with THREADKERNEL_LOAD_ONE meaning 100%. 
+ */
+#define THREADKERNEL_LOAD_SAMPLE_MICROS 250000
+#define THREADKERNEL_LOAD_ONE           65536
+#define THREADKERNEL_LOAD_AVERAGES      3
+#define THREADKERNEL_LOAD_1S            0
+#define THREADKERNEL_LOAD_10S           1
+#define THREADKERNEL_LOAD_60S           2
+
+/*
+  What the kernel does when a process runs for longer than its budget. Each 
+  overrun is counted whatever the policy. 
+  THREADKERNEL_BUDGET_BACKOFF doubles the period of a periodic process, up to 
+  THREADKERNEL_BUDGET_MAX_SHIFT times, and halves it again after each run 
+  which stays within budget. 
+  THREADKERNEL_BUDGET_DEMOTE does the same to the deadline which orders the 
+  process under THREADKERNEL_SCHEDULER_EDF, so it gives way to the others 
+  while its deadline misses are still counted against the real deadline. 
+ */
+typedef enum {
+  THREADKERNEL_BUDGET_REPORT, 
+  THREADKERNEL_BUDGET_BACKOFF, 
+  THREADKERNEL_BUDGET_DEMOTE
+} threadkernel_budget_policy_t; 
+
+#define THREADKERNEL_BUDGET_MAX_SHIFT 6
+
+/*
+  THREADKERNEL_SCHEDULER_LIST walks every periodic process on each pass and runs
+  the immediate processes after each of them. THREADKERNEL_SCHEDULER_HEAP keeps 
+  periodic processes in a min-heap keyed by nextRunMilliseconds so that a pass 
+  only touches the processes which are due, running the immediate processes 
+  after each one that runs (or once if none are due). 
+  THREADKERNEL_SCHEDULER_EDF uses the same heap to find the due processes, but 
+  runs them in order of their absolute deadline (nextRunMilliseconds plus 
+  deadlineMilliseconds), taking in processes which fall due while others run, 
+  and only then runs the immediate processes once. Urgent periodic work never 
+  waits behind a long immediate process. 
+ */
+typedef enum {
+  THREADKERNEL_SCHEDULER_LIST, 
+  THREADKERNEL_SCHEDULER_HEAP, 
+  THREADKERNEL_SCHEDULER_EDF
+} threadkernel_scheduler_t; 
+
+/*
+  A one-shot timer. Each kernel has its own pool of them. See after(). 
+ */
+struct threadkernel_timer_t_t 
+{
+  uint64_t      expiresMilliseconds; 
+  void          (*f)(void *); 
+  void*         context; 
+  threadkernel_timer_t* prev; 
+  threadkernel_t* kernel; 
+  // Next in the wheel slot, or in the free list. 
+  threadkernel_timer_t* next; 
+  // Bumped each time the timer is reused, so stale handles do not match. 
+  uint16_t      generation; 
+  uint8_t       level; 
+  uint8_t       slot; 
+}; 
+
 struct threadkernel_t_t 
 {
   unsigned int lastPid; 
 
+  // The process being run, or 0 between processes. 
+  process_t*    current; 
+
+  threadkernel_scheduler_t scheduler; 
+
   process_t*    processes;
   process_t*    immediateProcesses;
 
+  // Periodic processes ordered by nextRunMilliseconds (THREADKERNEL_SCHEDULER_HEAP and _EDF). 
+  process_t*    heap[THREADKERNEL_MAX_PROCESSES]; 
+  unsigned int  heapCount; 
+
+  // Due processes taken off the heap and not yet run (THREADKERNEL_SCHEDULER_EDF only). 
+  // Also holds the signalled processes while they are run, in any heap scheduler. 
+  process_t*    ready[THREADKERNEL_MAX_PROCESSES]; 
+  unsigned int  readyCount; 
+
+  // Set by signal() when any process of this kernel has been signalled. 
+  volatile unsigned char signalPending; 
+
+  // Processes removed during this pass, chained through prev and freed at the end of the pass. 
+  process_t*    removedProcesses; 
+
   unsigned long totalExecutions; 
 
-  double totalExecutionTimeSeconds; 
+  // Optional. Every process run is recorded here when set. 
+  threadkernel_trace_t* trace; 
+  unsigned char traceCore; 
+
+  // The kernel's own timers, so that its core never shares them with the other. 
+  threadkernel_timer_t  timerPool[THREADKERNEL_MAX_TIMERS]; 
+  unsigned int  timersUsed; 
+  threadkernel_timer_t* freeTimers; 
+
+  // Pending one-shot timers, and the tick the wheel has reached. 
+  threadkernel_timer_t* timerWheel[THREADKERNEL_TIMER_LEVELS][THREADKERNEL_TIMER_SLOTS]; 
+  uint64_t      timerWheelMillis; 
+  unsigned int  timerCount; 
+  unsigned long timersFired; 
 
-  unsigned long (*millis)(); 
-  unsigned long (*micros)(); 
+  // Migratable processes this kernel has run. 
+  unsigned long migratableRuns; 
 
+  // Processes and timers run, and the time spent inside them. The rest of 
+  // totalExecutionMicros is the kernel's own overhead. 
+  unsigned long dispatches; 
+  uint64_t      dispatchedMicros; 
+
+  // Sum of deadlineMisses over all of this kernel's processes. 
+  unsigned long deadlineMisses; 
+
+  // Sum of budgetOverruns over all of this kernel's processes, and the last 
+  // process to overrun. 
+  unsigned long budgetOverruns; 
+  unsigned int  lastBudgetOverrunPid; 
+
+  uint64_t      totalExecutionMicros; 
+
+  // Time spent in onIdle, and the time the kernel was created, for working out utilisation. 
+  uint64_t      idleMicros; 
+  uint64_t      createdMicros; 
+
+  // When the load averages were last sampled, and totalExecutionMicros then. 
+  uint64_t      loadSampleMicros; 
+  uint64_t      loadSampleBusyMicros; 
+  uint32_t      load[THREADKERNEL_LOAD_AVERAGES]; 
+
+  // 64 bit clocks, which do not roll over in practice. 
+  uint64_t      (*millis)(); 
+  uint64_t      (*micros)(); 
+
+  // Return 0 when the process pool is exhausted. 
   process_t*    (*add)              (threadkernel_t *k, void (*f)(), unsigned long periodMilliseconds);
   process_t*    (*addImmediate)     (threadkernel_t *k, void (*f)());
+  // As add and addImmediate, but f is called with the given context, for 
+  // instance to poll one of several devices: 
+  // k->addWithContext(k, [](void *fan) { ((PWMFan *)fan)->execute(); }, &fan, 1000); 
+  process_t*    (*addWithContext)   (threadkernel_t *k, void (*f)(void *), void *context, unsigned long periodMilliseconds);
+  process_t*    (*addImmediateWithContext)(threadkernel_t *k, void (*f)(void *), void *context);
+  // Adds a periodic process which is shared by all kernels rather than owned 
+  // by k. Whichever kernel finds nothing of its own to do at the end of a pass 
+  // runs the migratable process which is due soonest, so work moves to the 
+  // least busy core. If no kernel is ever idle, a busy one runs it once it is 
+  // a whole period late. f must be safe to run on either core, and the process 
+  // should only be removed, suspended or changed from inside itself. Set the 
+  // lock with threadkernel_set_lock when kernels run on more than one core. 
+  process_t*    (*addMigratable)    (threadkernel_t *k, void (*f)(), unsigned long periodMilliseconds);
   
   void          (*run)              (threadkernel_t *k);
 
+  // Calls f(context) once on k's core, at the start of the first pass at 
+  // least the given number of milliseconds from now. Returns a handle for 
+  // cancel(), or 0 when k's timer pool is exhausted. Insert and cancel are 
+  // O(1). Both must be called on the core which owns k. 
+  unsigned long (*after)            (threadkernel_t *k, unsigned long milliseconds, void (*f)(void *), void *context);
+  // Returns whether the timer was still pending. Handles of timers which have 
+  // fired or been cancelled are safe to pass. 
+  int           (*cancel)           (threadkernel_t *k, unsigned long timer);
+
+  // O(1) lookup in a table indexed by pid. Returns 0 if the pid belongs to another kernel. 
   process_t*    (*getProcessByPid)  (threadkernel_t *k, unsigned int pid);
 
+  // Iterates over the immediate processes followed by the periodic ones: 
+  // for (p = k->firstProcess(k); p; p = k->nextProcess(k, p)) 
+  process_t*    (*firstProcess)     (threadkernel_t *k);
+  process_t*    (*nextProcess)      (threadkernel_t *k, process_t *process);
+
+  // Runtime control. Must be called on the core which owns k, but may be called 
+  // from inside any process, including the one being changed. 
+  void          (*remove)           (threadkernel_t *k, process_t *process);
+  void          (*suspend)          (threadkernel_t *k, process_t *process);
+  void          (*resume)           (threadkernel_t *k, process_t *process);
+  void          (*setPeriod)        (threadkernel_t *k, process_t *process, unsigned long periodMilliseconds);
+  // Milliseconds after it falls due by which a periodic process must have 
+  // finished. 0 means its period, which is the default. 
+  void          (*setDeadline)      (threadkernel_t *k, process_t *process, unsigned long deadlineMilliseconds);
+  // Microseconds a single run of the process may take. 0, the default, means 
+  // no limit. 
+  void          (*setBudget)        (threadkernel_t *k, process_t *process, unsigned long budgetMicros, threadkernel_budget_policy_t policy);
+
+  // Makes the process run on the next pass of k even if it is not due. Safe to 
+  // call from an ISR or from the other core. 
+  void          (*signal)           (threadkernel_t *k, process_t *process);
+
+  // Called by the running process. It is not run again until it is signalled. A 
+  // signal which arrived while it was running wakes it on the next pass. 
+  void          (*wait)             (threadkernel_t *k);
+
+  // Called by the running process. It is not run again for the given number of 
+  // milliseconds unless it is signalled. A periodic process's next run moves 
+  // to the end of the sleep, and its schedule carries on from there. 
+  void          (*sleep)            (threadkernel_t *k, unsigned long milliseconds);
+
+  // Called by the running process when it found nothing to do, so the run is 
+  // counted in wastedExecutions. 
+  void          (*nothingToDo)      (threadkernel_t *k);
+
+  // Optional. Called around each process. 
   void          (*afterProcess)     (process_t *);
   void          (*beforeProcess)    (process_t *);
-  void          (*onMillisRollover) ();
+
+  // Optional. Called at the end of a pass when nothing can run for the given 
+  // number of milliseconds, which is UINT64_MAX if there are no processes. It 
+  // may sleep for up to that long, but should return early on an interrupt or 
+  // onSignal. If unset, run() returns straight away as before. 
+  void          (*onIdle)           (threadkernel_t *k, uint64_t milliseconds);
+
+  // Optional. Called by signal() after flagging the process, for instance to 
+  // wake the owning core from onIdle. 
+  void          (*onSignal)         ();
 };
 
+/*
+  Buckets are 16 bits wide. When one fills up, all of them are halved, so the 
+  histogram gradually forgets old samples rather than overflowing. 
+ */
+struct process_histogram_t_t 
+{
+  uint16_t      buckets[THREADKERNEL_HISTOGRAM_BUCKETS]; 
+  unsigned long count; 
+  unsigned long max; 
+}; 
+
+/*
+  Fields are ordered widest first to avoid padding. 
+ */
 struct process_t_t 
 {
-  unsigned int pid; 
+  uint64_t      nextRunMilliseconds; 
+  uint64_t      totalExecutionMicros; 
+  // totalExecutionMicros when the kernel last sampled the load averages. 
+  uint64_t      loadSampleMicros; 
+
+  // The kernel which runs this process, or 0 if the slot is free. 
+  threadkernel_t* kernel; 
+
+  // Exactly one of f and fWithContext is set. 
+  void (*f)(); 
+  void (*fWithContext)(void *); 
+  void* context; 
+
+  process_t* prev; 
+  process_t* next; 
 
   unsigned long periodMilliseconds; 
-  unsigned long nextRunMilliseconds; 
+  // 0 means the deadline is the period. 
+  unsigned long deadlineMilliseconds; 
 
   unsigned long skippedExecutions; 
+  // Executions of a periodic process which finished after their deadline. 
+  unsigned long deadlineMisses; 
+
+  unsigned long budgetMicros; 
+  // Executions which took longer than budgetMicros. 
+  unsigned long budgetOverruns; 
+
+  // Runs of a migratable process on a different kernel to its previous run. 
+  unsigned long migrations; 
   unsigned long totalExecutions; 
+  // Executions which reported nothingToDo(). The rest did useful work. 
+  unsigned long wastedExecutions; 
 
-  double totalExecutionTimeSeconds; 
+  // Share of the kernel's time spent in f(). Not kept for migratable processes. 
+  uint32_t      load[THREADKERNEL_LOAD_AVERAGES]; 
 
-  void (*f)(); 
+  // Time spent in f() on each execution. 
+  process_histogram_t executionMicros; 
+  // Actual start minus nextRunMilliseconds on each execution of a periodic process. 
+  process_histogram_t latenessMilliseconds; 
+  // Finish minus deadline on each execution which missed its deadline. 
+  process_histogram_t overrunMilliseconds; 
 
-  process_t* next; 
+  // Where a coroutine process resumes. See CO_BEGIN. 
+  uint16_t coroutineLine; 
+
+  // One more than the process's slot in the pool. Pids are reused after remove(). 
+  uint16_t pid; 
+
+  // Position in the kernel's heap, or -1 when not in it. 
+  int16_t heapIndex; 
+
+  // Position in the kernel's ready set, or -1 when not in it (THREADKERNEL_SCHEDULER_EDF only). 
+  int16_t readyIndex; 
+
+  // Set by signal(), cleared by the owning kernel before it runs the process. 
+  volatile unsigned char signalled; 
+
+  // Set by wait(), cleared when the process is signalled. Only touched by the owning kernel. 
+  unsigned char waiting; 
+
+  unsigned char immediate; 
+  unsigned char suspended; 
+  // 2 while a migratable process removed by one kernel is still running on another. 
+  unsigned char removed; 
+
+  unsigned char migratable; 
+  // Set while a kernel is running a migratable process, so the other leaves it alone. 
+  volatile unsigned char running; 
+
+  unsigned char budgetPolicy; 
+  // How many times the period or deadline is currently doubled by the budget policy. 
+  unsigned char budgetShift; 
 }; 
 
-// Constructor 
+/*
+  One process run. startMicros is the kernel's full micros clock, since its 
+  low 32 bits wrap every ~71.6 minutes and would put a ring which spans the 
+  wrap out of order. 
+ */
+struct threadkernel_trace_record_t_t 
+{
+  uint64_t      startMicros; 
+  uint32_t      durationMicros; 
+  uint16_t      pid; 
+  uint8_t       core; 
+  // Which boot the record was made in, counting up from when the trace was reset. 
+  uint8_t       boot; 
+}; 
+
+/*
+  A ring of the most recent process runs. It holds no pointers so that it can 
+  be placed in memory which survives a watchdog reboot, and a record is 
+  written before the process starts so the one which hung is in it. Only the 
+  owning kernel writes to it; a reader on another core may see a torn record. 
+ */
+struct threadkernel_trace_t_t 
+{
+  uint32_t      magic; 
+  // Total records ever written. The next one goes at next % THREADKERNEL_TRACE_RECORDS. 
+  uint32_t      next; 
+  uint8_t       boot; 
+  threadkernel_trace_record_t records[THREADKERNEL_TRACE_RECORDS]; 
+}; 
+
+/*
+  Stackless coroutines, in the style of protothreads. A process function 
+  which is wrapped in CO_BEGIN and CO_END can return to the kernel part way 
+  through with CO_YIELD or CO_SLEEP, and carries on from that point the next 
+  time it runs rather than from the top. Local variables are not kept across 
+  a yield, so state must live in statics or members, and there can be no 
+  switch statement around a yield. 
+
+    void task_relays()
+    {
+      static unsigned int i; 
+      CO_BEGIN(k); 
+      for (i = 0; i < RELAYS; i++)
+      {
+        setRelay(i); 
+        CO_SLEEP(k, 500); 
+      }
+      CO_END(k); 
+    }
+
+  An immediate process resumes on the next pass, or when its sleep ends. A 
+  periodic process resumes at its next run. 
+ */
+#define CO_BEGIN(k)         switch((k)->current->coroutineLine) { case 0:
+#define CO_YIELD(k)         do { (k)->current->coroutineLine = __LINE__; return; case __LINE__:; } while(0)
+#define CO_SLEEP(k, ms)     do { (k)->sleep((k), (ms)); CO_YIELD(k); } while(0)
+#define CO_WAIT(k)          do { (k)->wait(k); CO_YIELD(k); } while(0)
+#define CO_END(k)           } (k)->current->coroutineLine = 0
+
+// Constructors. Return 0 when THREADKERNEL_MAX_KERNELS kernels already exist. 
 threadkernel_t* create_threadkernel(
-  unsigned long (*millis)(), 
-  void (*onMillisRollover)(), 
-  unsigned long (*micros)(), 
+  uint64_t (*millis)(), 
+  uint64_t (*micros)(), 
   void (*beforeProcess)(process_t *), 
   void (*afterProcess)(process_t *)
 );
 
+threadkernel_t* create_threadkernel_with_scheduler(
+  uint64_t (*millis)(), 
+  uint64_t (*micros)(), 
+  void (*beforeProcess)(process_t *), 
+  void (*afterProcess)(process_t *), 
+  threadkernel_scheduler_t scheduler
+);
+
 static process_t* __threadkernel_addImmediate(threadkernel_t *k, void (*f)());
 static process_t* __threadkernel_add(threadkernel_t *k, void (*f)(), unsigned long periodMilliseconds);
+static process_t* __threadkernel_add_with_context(threadkernel_t *k, void (*f)(void *), void *context, unsigned long periodMilliseconds);
+static process_t* __threadkernel_add_immediate_with_context(threadkernel_t *k, void (*f)(void *), void *context);
+static process_t* __threadkernel_add_migratable(threadkernel_t *k, void (*f)(), unsigned long periodMilliseconds);
 static void __threadkernel_run(threadkernel_t *k);
+static unsigned long __threadkernel_after(threadkernel_t *k, unsigned long milliseconds, void (*f)(void *), void *context);
+static int __threadkernel_cancel(threadkernel_t *k, unsigned long timer);
 static process_t* __threadkernel_get_process_by_pid(threadkernel_t *k, unsigned int pid);
+static process_t* __threadkernel_first_process(threadkernel_t *k);
+static process_t* __threadkernel_next_process(threadkernel_t *k, process_t *process);
+static void __threadkernel_signal(threadkernel_t *k, process_t *process);
+static void __threadkernel_wait(threadkernel_t *k);
+static void __threadkernel_nothing_to_do(threadkernel_t *k);
+static void __threadkernel_sleep(threadkernel_t *k, unsigned long milliseconds);
+static void __threadkernel_remove(threadkernel_t *k, process_t *process);
+static void __threadkernel_suspend(threadkernel_t *k, process_t *process);
+static void __threadkernel_resume(threadkernel_t *k, process_t *process);
+static void __threadkernel_set_period(threadkernel_t *k, process_t *process, unsigned long periodMilliseconds);
+static void __threadkernel_set_deadline(threadkernel_t *k, process_t *process, unsigned long deadlineMilliseconds);
+static void __threadkernel_set_budget(threadkernel_t *k, process_t *process, unsigned long budgetMicros, threadkernel_budget_policy_t policy);
+
+// Writes a line per process with its executions, skips, deadline misses and 
+// lateness, followed by the kernel totals. Meant for runs off-device. 
+void threadkernel_print_stats(threadkernel_t *k, FILE *out); 
+
+// Average time spent by k around each process or timer it runs: scheduling, 
+// timing and the before and after hooks. 
+unsigned long threadkernel_dispatch_overhead_nanos(threadkernel_t *k); 
+
+// Starts recording k's process runs into trace, tagged with the given core. 
+// The trace keeps what it held before unless it was never initialised. 
+void threadkernel_attach_trace(threadkernel_t *k, threadkernel_trace_t *trace, unsigned char core); 
+
+// Empties the trace, for instance at power on. 
+void threadkernel_reset_trace(threadkernel_trace_t *trace); 
+
+// Number of records held, and the i'th of them, oldest first. 
+unsigned int threadkernel_trace_count(threadkernel_trace_t *trace); 
+threadkernel_trace_record_t* threadkernel_trace_record(threadkernel_trace_t *trace, unsigned int i); 
+
+// Guards the state shared by all kernels, the process pool and the migratable 
+// processes, against both cores. lock must spin until it has the lock, and is 
+// never taken twice by the same core. Not needed when all kernels run on one core. 
+void threadkernel_set_lock(void (*lock)(), void (*unlock)()); 
+
+// A load average as a percentage. 
+float threadkernel_load_percent(const uint32_t load[THREADKERNEL_LOAD_AVERAGES], unsigned int average); 
+
+// Process pool slots still free, and the number of adds which failed because it was empty. 
+unsigned int  threadkernel_processes_available(); 
+unsigned long threadkernel_process_allocation_failures(); 
+
+// Upper bound of the bucket containing the given percentile (0-100), clamped to the maximum seen. 
+unsigned long process_histogram_percentile(process_histogram_t *h, unsigned int percentile); 
+unsigned long process_histogram_p50(process_histogram_t *h); 
+unsigned long process_histogram_p99(process_histogram_t *h); 
+unsigned long process_histogram_max(process_histogram_t *h); 
 
 #endif 
\ No newline at end of file
@@ -0,0 +1,60 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the 
+ * Free Software Foundation, either version 3 of the License, or (at your 
+ * option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY 
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "timebase.h"
+
+#if defined(ARDUINO_ARCH_RP2040)
+#include <hardware/timer.h>
+#endif
+
+static uint64_t (*source)() = 0; 
+static uint64_t virtualMicros = 0; 
+
+static uint64_t virtual_clock()
+{
+  return virtualMicros; 
+}
+
+uint64_t micros64()
+{
+  if (source)
+    return source(); 
+
+#if defined(ARDUINO_ARCH_RP2040)
+  return time_us_64(); 
+#else
+  return 0; 
+#endif
+}
+
+uint64_t millis64()
+{
+  return micros64() / 1000; 
+}
+
+void timebase_set_source(uint64_t (*micros)())
+{
+  source = micros; 
+}
+
+void timebase_use_virtual_clock(uint64_t startMicros)
+{
+  virtualMicros = startMicros; 
+  source = virtual_clock; 
+}
+
+void timebase_advance_virtual_clock(uint64_t micros)
+{
+  virtualMicros += micros; 
+}
@@ -0,0 +1,48 @@
+/*
+ * This program is free software: you can redistribute it and/or modify it 
+ * under the terms of the GNU General Public License as published by the 
+ * Free Software Foundation, either version 3 of the License, or (at your 
+ * option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY 
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+ * more details.
+ * 
+ * You should have received a copy of the GNU General Public License along 
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+    A 64 bit monotonic clock for the Pi Pico RP2040. 
+
+    millis() and micros() are 32 bits wide and roll over after ~49.7 days and 
+    ~71.6 minutes respectively. The RP2040 timer is 64 bits wide, so time taken 
+    from it will not roll over in practice and may be compared directly. 
+
+    Author: Andrew Somerville <andy16666@gmail.com> 
+    GitHub: andy16666
+ */
+#ifndef TIMEBASE_HH
+#define TIMEBASE_HH
+#include <stdint.h>
+
+// Microseconds since boot. 
+uint64_t micros64(); 
+
+// Milliseconds since boot. 
+uint64_t millis64(); 
+
+// Replaces the hardware timer with the given microsecond clock, for instance a 
+// virtual clock when running off-device. Passing 0 restores the hardware timer. 
+void timebase_set_source(uint64_t (*micros)()); 
+
+// Switches to a virtual clock which starts at the given time and only moves 
+// when advanced, so that scheduling can be replayed deterministically. 
+void timebase_use_virtual_clock(uint64_t startMicros); 
+
+// Moves the virtual clock forward, for instance by the cost of a simulated 
+// process or from a threadkernel onIdle hook. 
+void timebase_advance_virtual_clock(uint64_t micros); 
+
+#endif